@@ -4,6 +4,58 @@ Chip resources used:	A2D Module & Pins setup as analog inputs
 Purpose:				Scan A2D, perform DSP to increase resolution, and format accordingly
 
 Version History:
+v2.0.0	2026-10-18  agent
+	Event rules are now opt-in (A2D_EVENTS in the config file), without it every value calls the finished function
+	Adaptive oversampling is now opt-in (A2D_ADAPTIVE), A2D_Channel_Resolution() stays and reports the channel settings
+	Calibration is now opt-in (A2D_CALIBRATION), that includes A2D_Calibrate() and A2D_Calibrate_Channels()
+	Waveform capture is now opt-in (A2D_CAPTURE)
+	Streaming channels are now opt-in (A2D_STREAMING)
+	Lazy formatting is now opt-in (A2D_LAZY_FORMATTING), without it every value is formatted as it is published
+	Deadlines and admission control are now opt-in (A2D_DEADLINES), the predicted periods are always available
+	Spike filters are now opt-in (A2D_FILTERS), the sorting networks are only compiled in with them
+	Demand gating is now opt-in (A2D_GATING), A2D_Idle() stays and modules with nothing scheduled still power down
+v1.21.0	2026-10-18  agent
+	Added waveform capture of raw samples or values, with manual and threshold triggers (A2D_Channel_Capture())
+v1.20.0	2026-10-18  agent
+	Added demand gating, gated channels are only scanned while a value has been requested (A2D_Request())
+v1.19.0	2026-10-18  agent
+	Added calibration, a fixed point offset and gain with an optional lookup table (A2D_Channel_Calibration())
+v1.18.0	2026-10-18  agent
+	Added median, trimmed mean and k-sigma spike filters on each burst (A2D_Channel_Filter())
+v1.17.0	2026-10-18  agent
+	Added A2D_Process_Burst() and A2D_Replay.c for running recorded samples through the pipeline
+v1.16.0	2026-10-18  agent
+	Added AD2 and channels 16 to 31, the driver now works through a per module instance
+v1.15.0	2026-10-18  agent
+	Added timed scanning (SCAN_MODE_TIMED) off Timer3, and burst to burst jitter measurement
+v1.14.0	2026-10-18  agent
+	Added deadlines, predicted periods, slack and admission control, and the A2D_Planner.c host tool
+v1.13.0	2026-10-18  agent
+	Added adaptive oversampling, the resolution drops on transients and steps back up on steady signals
+v1.12.0	2026-10-18  agent
+	Added event rules for the finished function (threshold, window and change, with hysteresis)
+v1.11.0	2026-10-18  agent
+	Added lazy formatting, the format function runs on the first read of a new value
+v1.10.0	2026-10-18  agent
+	Added static channels (A2D_STATIC_CHANNELS), a channel table compiled into program memory
+v1.9.0	2026-10-18  agent
+	Added consistent multi-channel snapshots (A2D_Read_Channels()) and per channel sequence counters
+v1.8.0	2026-10-18  agent
+	Added opt-in telemetry (A2D_TELEMETRY) of update periods, latency, overruns and execution times
+v1.7.0	2026-10-18  agent
+	Added a lock-free burst ring between the ISR and A2D_Routine(), with dropped burst and high-water mark counters
+v1.6.0	2026-10-18  agent
+	Added streaming channels, a sliding window publishes a new value every block
+v1.5.0	2026-10-18  agent
+	Replaced the decimation divide with shifts and a reciprocal multiply, and added optional rounding
+v1.4.0	2026-10-18  agent
+	Replaced the scan queue with per channel weights compiled into a smooth weighted round robin schedule
+v1.3.0	2026-10-18  agent
+	Added multi-channel bursts, several channels share one burst through a single CSSL mask
+v1.2.0	2026-10-18  agent
+	Added continuous scanning through the split buffer
+v1.1.0	2026-10-18  agent
+	Added the host simulator seam (A2D_Sim.c) and A2D_Bench.c, a host benchmark and cross-check
 v1.0.0	2015-01-10  Craig Comberbach
 	Compiler: XC16 v1.11	IDE: MPLABx 2.20	Tool: ICD3	Computer: Intel Core2 Quad CPU 2.40 GHz, 5 GB RAM, Windows 7 64 bit Home Premium SP1
 	Added full scanning functionality
@@ -18,7 +70,7 @@ v0.0.0	2013-07-18  Craig Comberbach
 #include "A2D.h"
 
 /************* Semantic Versioning***************/
-#if A2D_MAJOR != 1
+#if A2D_MAJOR != 2
 	#error "A2D.c has had a change that loses some previously supported functionality"
 #elif A2D_MINOR != 0
 	#error "A2D.c has new features that this code may benefit from"
@@ -28,364 +80,2887 @@ v0.0.0	2013-07-18  Craig Comberbach
 
 /************Arbitrary Functionality*************/
 /*************   Magic  Numbers   ***************/
-#define	NUMBER_OF_CHANNELS	16
+#define	NUMBER_OF_CHANNELS	A2D_NUMBER_OF_CHANNELS	//Every input of every module, see A2D.h
 #define SCAN_BUFFER_SIZE	16	//Size of the scan buffer
+#define HALF_BUFFER_SIZE	8	//Size of each half of the scan buffer when it is split (BUFM = 1)
+#define ADC_RESOLUTION		10	//Native resolution of the converter in bits
+#define DECIMATION_PRECISION	15	//The reciprocal multipliers are 2^15 to 2^16 - 1, so they fit a 16 bit multiply, see Configure_Decimation()
+#define GAIN_FRACTION_BITS	12	//Calibration gains are fixed point, A2D_UNITY_GAIN (4096) = 1.0
+
+/*************  Channel  Mapping  ***************/
+#ifdef A2D_STATIC_CHANNELS
+	#define CHANNEL_INDEX(channel)	(channelSlot[channel] - 1)	//Only the channels in A2D_STATIC_CHANNELS have storage
+	#define CHANNEL_IN_USE(channel)	(((channel) >= 0) && ((channel) < NUMBER_OF_CHANNELS) && (channelSlot[channel] != 0))
+
+	//Compile time versions of A2D_Channel_Settings() and Configure_Decimation(), every argument must be a constant
+	#define STATIC_DIVISOR(resolution, averages)			((unsigned long)(averages) << (resolution))
+	#define STATIC_SAMPLES(resolution, averages)			((unsigned long)(averages) << (2 * (resolution)))
+	#define STATIC_MAXIMUM(resolution)						((1ul << (ADC_RESOLUTION + (resolution))) - 1)
+	#define STATIC_LOWEST_BIT(divisor)						((divisor) & (~(divisor) + 1))
+	#define STATIC_ODD_PART(resolution, averages)			(STATIC_DIVISOR(resolution, averages) / STATIC_LOWEST_BIT(STATIC_DIVISOR(resolution, averages)))
+	#define STATIC_DECIMATION_SHIFT(resolution, averages)	CEILING_LOG2(STATIC_LOWEST_BIT(STATIC_DIVISOR(resolution, averages)))
+	#define STATIC_RECIPROCAL_SHIFT(resolution, averages)	((STATIC_ODD_PART(resolution, averages) == 1) ? 0 : DECIMATION_PRECISION + CEILING_LOG2(STATIC_ODD_PART(resolution, averages)))
+	#define STATIC_MULTIPLIER(resolution, averages)			((STATIC_ODD_PART(resolution, averages) == 1) ? 0 : \
+		(unsigned int)((1ul << STATIC_RECIPROCAL_SHIFT(resolution, averages)) / STATIC_ODD_PART(resolution, averages)))
+	#define CEILING_LOG2(x)	(((x) <= 1ul) ? 0 : ((x) <= 2ul) ? 1 : ((x) <= 4ul) ? 2 : ((x) <= 8ul) ? 3 : ((x) <= 16ul) ? 4 : ((x) <= 32ul) ? 5 :	\
+		((x) <= 64ul) ? 6 : ((x) <= 128ul) ? 7 : ((x) <= 256ul) ? 8 : ((x) <= 512ul) ? 9 : ((x) <= 1024ul) ? 10 : ((x) <= 2048ul) ? 11 :	\
+		((x) <= 4096ul) ? 12 : ((x) <= 8192ul) ? 13 : ((x) <= 16384ul) ? 14 : ((x) <= 32768ul) ? 15 : ((x) <= 65536ul) ? 16 :			\
+		((x) <= 131072ul) ? 17 : ((x) <= 262144ul) ? 18 : ((x) <= 524288ul) ? 19 : ((x) <= 1048576ul) ? 20 : ((x) <= 2097152ul) ? 21 : 22)
+#else
+	#define CHANNELS_USED			NUMBER_OF_CHANNELS
+	#define CHANNEL_INDEX(channel)	(channel)
+	#define CHANNEL_IN_USE(channel)	(((channel) >= 0) && ((channel) < NUMBER_OF_CHANNELS))
+#endif
+#define CHANNEL_MODULE(channel)		(&modules[(channel) / A2D_INPUTS_PER_MODULE])	//Channels are numbered module * A2D_INPUTS_PER_MODULE + input
+#define CHANNEL_INPUT(channel)		((channel) % A2D_INPUTS_PER_MODULE)
+#define MODULE_IN_RANGE(number)		(((number) >= 0) && ((number) < A2D_NUMBER_OF_MODULES))
+#define MASK_BIT(bit)				((A2D_CHANNEL_MASK)1 << (bit))	//Channel and scan masks are 32 bits once there are more than 16 channels
+
+/*************    Enumeration     ***************/
+#ifdef A2D_CAPTURE
+enum CAPTURE_STATE
+{
+	CAPTURE_ARMED,		//Recording into the ring, waiting for the trigger
+	CAPTURE_TRIGGERED,	//Recording the entries that follow the trigger
+	CAPTURE_FROZEN		//Finished, the ring is left alone until the capture is armed again
+};
+#endif
+
+/*************ArbitraryFunctionality*************/
+#define MAX_SCHEDULE_SIZE	64	//Max size of the scan schedule (the sum of all channel weights)
+#ifdef A2D_STATIC_CHANNELS
+	//A fixed table only ever needs room for its own weights, the sum of each module's entries (a failure to fit is checked below)
+	enum A2D_Static_Weight
+	{
+		#define A2D_CHANNEL(channel, resolution, averages, format, pre, post, finished, weight)	+ ((((channel) / A2D_INPUTS_PER_MODULE) == 0) ? (weight) : 0)
+		STATIC_WEIGHT_AD1 = 0 A2D_STATIC_CHANNELS,
+		#undef A2D_CHANNEL
+		#define A2D_CHANNEL(channel, resolution, averages, format, pre, post, finished, weight)	+ ((((channel) / A2D_INPUTS_PER_MODULE) == 1) ? (weight) : 0)
+		STATIC_WEIGHT_AD2 = 0 A2D_STATIC_CHANNELS
+		#undef A2D_CHANNEL
+	};
+	#define STATIC_WEIGHT		((STATIC_WEIGHT_AD1 > STATIC_WEIGHT_AD2) ? STATIC_WEIGHT_AD1 : STATIC_WEIGHT_AD2)
+	#define SCHEDULE_SIZE		((STATIC_WEIGHT != 0) ? STATIC_WEIGHT : 1)	//Every module shares the struct, so the busier one sets the size
+#else
+	#define SCHEDULE_SIZE		MAX_SCHEDULE_SIZE
+#endif
+#ifndef A2D_BURST_TIME
+	#define A2D_BURST_TIME	1	//Ticks per burst used by the planner until A2D_Planner_Burst_Time() is called, can be overridden in the config file
+#endif
+#ifndef A2D_SAMPLE_PERIOD
+	#define A2D_SAMPLE_PERIOD	1600	//Instruction cycles between samples in SCAN_MODE_TIMED (10kHz at 16 MIPS), can be overridden in the config file
+#endif
+#ifndef A2D_RC_TAD_CYCLES
+	#define A2D_RC_TAD_CYCLES	4	//A/D internal RC clock period in instruction cycles (~250ns at 16 MIPS), can be overridden in the config file
+#endif
+#ifndef A2D_BURST_RING_SIZE
+	#define A2D_BURST_RING_SIZE	4	//Bursts that can wait between the ISR and A2D_Routine(), can be overridden in the config file
+#endif
+#define BURST_RING_SIZE		A2D_BURST_RING_SIZE
+#define BURST_RING_MASK		(BURST_RING_SIZE - 1)
+#if (BURST_RING_SIZE < 1) || (BURST_RING_SIZE > 128) || (BURST_RING_SIZE & BURST_RING_MASK)
+	#error "A2D_BURST_RING_SIZE must be a power of 2 between 1 and 128"
+#endif
+
+/************* Module Definitions ***************/
+#if (A2D_NUMBER_OF_MODULES < 1) || (A2D_NUMBER_OF_MODULES > 2)
+	#error "A2D_NUMBER_OF_MODULES must be 1 (AD1) or 2 (AD1 and AD2)"
+#endif
+#if (A2D_INPUTS_PER_MODULE < 1) || (A2D_INPUTS_PER_MODULE > 32) || (A2D_NUMBER_OF_CHANNELS > 32)
+	#error "A2D_INPUTS_PER_MODULE must be between 1 and 32, with no more than 32 channels across every module"
+#endif
+#if (A2D_INPUTS_PER_MODULE > 16) || (A2D_NUMBER_OF_MODULES > 1)
+	#define AD1_PORT_CONFIG	AD1PCFGL	//Parts with more than 16 inputs (or a second module) split the port configuration into L/H
+#else
+	#define AD1_PORT_CONFIG	AD1PCFG
+#endif
+
+//ADxCON1, ADxCON2 and ADxCON3 bits, AD2 has the same layout as AD1 so every module is driven through its register pointers
+#define CON1_ADON		0x8000	//ADON - A/D Operating Mode bit
+#define CON1_ADSIDL		0x2000	//ADSIDL - Stop in Idle Mode bit
+#define CON1_SSRC		0x00E0	//SSRC<2:0> - Conversion Trigger Source Select bits
+#define AUTO_CONVERT	0x00E0	//SSRC = 111 - Internal counter ends sampling and starts conversion
+#define TIMER3_TRIGGER	0x0040	//SSRC = 010 - Timer3 compare ends sampling and starts conversion
+#define CON1_ASAM		0x0004	//ASAM - A/D Sample Auto-Start bit
+#define CON2_CSCNA		0x0400	//CSCNA - Scan Input Selections for CH0+ S/H Input for MUX A bit
+#define CON2_BUFS		0x0080	//BUFS - Buffer Fill Status bit (Read Only)
+#define CON2_SMPI		0x003C	//SMPI<3:0> - Sample/Convert Sequences Per Interrupt Selection bits
+#define SMPI_16			0x003C	//SMPI = 1111 - Interrupts at the completion of conversion for each 16th sample/convert sequence
+#define SMPI_8			0x001C	//SMPI = 0111 - Interrupts at the completion of conversion for each 8th sample/convert sequence
+#define CON2_BUFM		0x0002	//BUFM - Buffer Mode Select bit
+#define CON3_ADRC		0x8000	//ADRC - A/D Conversion Clock Source bit
+#define CON3_SAMC		0x1F00	//SAMC<4:0> - Auto-Sample Time bits
+#define CON3_ADCS		0x00FF	//ADCS<7:0> - A/D Conversion Clock Select bits
+#define CONVERSION_TAD	12		//TAD the conversion itself takes once sampling has ended
+#define	STOP_SCAN(module)	(*(module)->registers->control1 &= ~CON1_ASAM)	//Stops the scanning of channels
+#define	START_SCAN(module)	(*(module)->registers->control1 |= CON1_ASAM)	//Starts the scanning of channels
+#define	MODULE_OFF(module)	(*(module)->registers->control1 &= ~CON1_ADON)
+#define	MODULE_ON(module)	(*(module)->registers->control1 |= CON1_ADON)
+
+//The flags share IFSx/IECx with other peripherals, so they are only ever touched through the bit fields (a single BCLR/BSET)
+#if A2D_NUMBER_OF_MODULES > 1
+	#define CLEAR_INTERRUPT(module)				((module)->number ? (IFS1bits.AD2IF = 0) : (IFS0bits.AD1IF = 0))
+	#define ENABLE_INTERRUPT(module, enable)	((module)->number ? (IEC1bits.AD2IE = (enable)) : (IEC0bits.AD1IE = (enable)))
+#else
+	#define CLEAR_INTERRUPT(module)				(IFS0bits.AD1IF = 0)
+	#define ENABLE_INTERRUPT(module, enable)	(IEC0bits.AD1IE = (enable))
+#endif
+#if defined(A2D_TELEMETRY) && !defined(A2D_TIMESTAMP)
+	#error "A2D_TELEMETRY needs A2D_TIMESTAMP() defined in the config file as a free running tick count"
+#endif
+#if defined(A2D_STATIC_DEADLINES) && !defined(A2D_DEADLINES)
+	#error "A2D_STATIC_DEADLINES needs A2D_DEADLINES defined in the config file"
+#endif
+#ifndef A2D_INTERRUPT_ATTRIBUTES
+	#define A2D_INTERRUPT_ATTRIBUTES	__attribute__((__interrupt__, auto_psv))	//Host builds (A2D_Sim.h) define this as empty
+#endif
+
+/************* Other  Definitions ***************/
+/*************  Global Variables  ***************/
+unsigned char scanWeight[NUMBER_OF_CHANNELS];		//How many times per schedule cycle each channel is scanned (0 = not scanned)
+struct A2D_Schedule_Slot
+{
+	A2D_CHANNEL_MASK mask;				//CSSL (and CSSH) mask selecting every input in the burst
+	unsigned char first;				//Index of the first channel of the burst in scheduleChannels[]
+	unsigned char count;				//Number of channels in the burst
+};
+struct A2D_Burst
+{
+	unsigned char slot;						//The schedule slot the burst was taken for (tells us which channels are in it)
+	unsigned int samples[SCAN_BUFFER_SIZE];	//Raw copy of the buffer, in the order the module filled it
+	#ifdef A2D_TELEMETRY
+		unsigned long timestamp;			//A2D_TIMESTAMP() when the burst finished
+	#endif
+};
+struct A2D_Module_Registers
+{
+	volatile unsigned int *buffer;			//ADCxBUF0, the first word of the scan buffer
+	volatile unsigned int *control1;		//ADxCON1
+	volatile unsigned int *control2;		//ADxCON2
+	volatile unsigned int *control3;		//ADxCON3
+	volatile unsigned int *inputSelect;		//ADxCHS
+	volatile unsigned int *scanSelectLow;	//ADxCSSL, inputs 0 to 15
+	volatile unsigned int *portConfigLow;	//ADxPCFG(L), inputs 0 to 15
+	#if A2D_INPUTS_PER_MODULE > 16
+		volatile unsigned int *scanSelectHigh;	//ADxCSSH, inputs 16 to 31
+		volatile unsigned int *portConfigHigh;	//ADxPCFGH, inputs 16 to 31
+	#endif
+};
+const struct A2D_Module_Registers moduleRegisters[A2D_NUMBER_OF_MODULES] =
+{
+	{&ADC1BUF0, &AD1CON1, &AD1CON2, &AD1CON3, &AD1CHS, &AD1CSSL, &AD1_PORT_CONFIG
+		#if A2D_INPUTS_PER_MODULE > 16
+			, &AD1CSSH, &AD1PCFGH
+		#endif
+	},
+	#if A2D_NUMBER_OF_MODULES > 1
+		{&ADC2BUF0, &AD2CON1, &AD2CON2, &AD2CON3, &AD2CHS, &AD2CSSL, &AD2PCFGL
+			#if A2D_INPUTS_PER_MODULE > 16
+				, &AD2CSSH, &AD2PCFGH
+			#endif
+		},
+	#endif
+};
+struct A2D_Module
+{
+	unsigned char number;								//0 = AD1, 1 = AD2
+	unsigned char firstChannel;							//The channel number of the module's AN0
+	const struct A2D_Module_Registers *registers;
+	struct A2D_Schedule_Slot scanSchedule[SCHEDULE_SIZE];	//The precompiled order of bursts, walked in a circle
+	volatile unsigned char scheduleChannels[SCHEDULE_SIZE];	//The channels of each burst, in the (ascending) order the module scans them
+	volatile unsigned char scheduleLength;
+	volatile unsigned char currentSlot;
+	volatile unsigned char *burstChannels;				//The channels in the current burst (points into scheduleChannels[])
+	volatile char burstChannelCount;					//0 = No burst selected, the next call to A2D_Routine() (re)starts the schedule
+	volatile char channelsPerBurst;						//The most channels that may share a single burst
+	volatile char samplesPerInterrupt;
+	volatile enum SCAN_MODE scanMode;
+	volatile char halvesCollected;
+	volatile unsigned char idle;						//1 = The module is powered down (ADON = 0) because nothing on it is due
+	struct A2D_Burst burstRing[BURST_RING_SIZE];		//Single producer (ISR) single consumer (A2D_Routine()) ring of finished bursts
+	volatile unsigned char burstHead;					//Only written by the ISR, free running (the ring index is the bottom bits)
+	volatile unsigned char burstTail;					//Only written by A2D_Routine(), free running
+	volatile char burstWriting;							//Continuous mode: 1 = The burst being collected has a place in the ring
+	volatile unsigned int droppedBursts;				//Bursts thrown away because the ring was full
+	volatile unsigned char burstHighWaterMark;			//The most bursts that have been waiting in the ring at once
+	unsigned long plannedBurstTime;						//Ticks each burst takes, the unit of the predicted periods and deadlines
+	#ifdef A2D_TIMESTAMP
+		struct A2D_Burst_Jitter burstJitter;
+		unsigned long long intervalSum;					//Total of every interval measured, for the average
+		unsigned long lastBurstEnd;						//A2D_TIMESTAMP() at the end of the last burst
+		unsigned char lastBurstValid;					//1 = lastBurstEnd can be measured from
+	#endif
+} modules[A2D_NUMBER_OF_MODULES];
+volatile unsigned int publishSequence;		//Odd while A2D_Routine() is publishing values (seqlock for A2D_Read_Channels())
+A2D_CHANNEL_MASK finishedChannels;			//One bit per channel whose finished function is due once publishing is done
+unsigned int samplePeriod;					//Instruction cycles between samples in SCAN_MODE_TIMED
+#ifdef A2D_DEADLINES
+	unsigned char admissionControl;			//1 = Changes that would make a channel miss its deadline are rejected
+#endif
+#ifdef A2D_GATING
+	volatile A2D_CHANNEL_MASK gatedChannels;	//One bit per channel that is only scanned while a value has been requested
+	volatile A2D_CHANNEL_MASK dueChannels;		//One bit per gated channel with a request outstanding
+	A2D_CHANNEL_MASK refreshChannels;			//One bit per gated channel that requests a value by itself every refreshInterval
+#endif
+struct A2D_Channel_Config
+{
+	unsigned char bitsOfResolutionIncrease;	//The number of bit of increased resolution (Default is 0 which is 10 bits)
+	unsigned int samplesRequired;			//The number of samples required to initate an averaging event (includes number of finished samples to make a final averaged sample)
+	unsigned int numberOfAverages;			//The number of readings (at the increased resolution) averaged into each value
+	unsigned char decimationShift;			//Right shift that divides out the power of two part of (numberOfAverages * 2^bitsOfResolutionIncrease)
+	unsigned char reciprocalShift;			//Right shift applied after multiplying by decimationMultiplier (at least 17)
+	unsigned int decimationMultiplier;		//Reciprocal of the odd part of the divisor, rounded down (0 = the divisor is a power of two, no multiply required)
+	unsigned int decimationDivisor;			//The odd part of the divisor, used to correct the quotient the reciprocal gives
+	unsigned long maximumValue;				//Largest value the requested resolution can hold
+	int (*formatPointer)(int);				//Used to specify a function that handles the formating of the averaged value
+	void (*preFunction)(int);				//Used to specify a function that activates when a channel starts being scanned (eg for setting a switched pin)
+	void (*postFunction)(int);				//Used to specify a function that activates when a channel stops being scanned (eg for resetting a switched pin)
+	void (*finishedFunction)(int);			//Used to specify a function that activates when a channel finishes being scanned and a new value is created (eg For setting flags for functions that need to run as soon as a value is determined)
+};
+#ifdef A2D_STATIC_CHANNELS
+	//Every channel in the table is given the next index, the enumeration also rejects a channel listed twice
+	enum A2D_Static_Index
+	{
+		#define A2D_CHANNEL(channel, resolution, averages, format, pre, post, finished, weight)	STATIC_INDEX_##channel,
+		A2D_STATIC_CHANNELS
+		#undef A2D_CHANNEL
+		CHANNELS_USED
+	};
+
+	//Settings that never change live in program memory, the compiler works out the decimation factors
+	const struct A2D_Channel_Config channelConfig[CHANNELS_USED] =
+	{
+		#define A2D_CHANNEL(channel, resolution, averages, format, pre, post, finished, weight)	\
+			{resolution, STATIC_SAMPLES(resolution, averages), averages, STATIC_DECIMATION_SHIFT(resolution, averages), STATIC_RECIPROCAL_SHIFT(resolution, averages), STATIC_MULTIPLIER(resolution, averages), STATIC_ODD_PART(resolution, averages), STATIC_MAXIMUM(resolution), format, pre, post, finished},
+		A2D_STATIC_CHANNELS
+		#undef A2D_CHANNEL
+	};
+
+	//Channel number to index + 1 (0 = The channel isn't in the table)
+	const unsigned char channelSlot[NUMBER_OF_CHANNELS] =
+	{
+		#define A2D_CHANNEL(channel, resolution, averages, format, pre, post, finished, weight)	[channel] = STATIC_INDEX_##channel + 1,
+		A2D_STATIC_CHANNELS
+		#undef A2D_CHANNEL
+	};
+
+	//Loaded into the scan weights by A2D_Initialize()
+	const struct
+	{
+		unsigned char channel;
+		unsigned char weight;
+	} staticSchedule[CHANNELS_USED] =
+	{
+		#define A2D_CHANNEL(channel, resolution, averages, format, pre, post, finished, weight)	{channel, weight},
+		A2D_STATIC_CHANNELS
+		#undef A2D_CHANNEL
+	};
+
+	//The same limits A2D_Channel_Settings() and A2D_Scan_Weight() check at run time, a failure shows up as a negative array size
+	#define A2D_CHANNEL(channel, resolution, averages, format, pre, post, finished, weight)	\
+		typedef char STATIC_CHECK_##channel[(((resolution) >= RESOLUTION_10_BIT) && ((resolution) <= RESOLUTION_16_BIT) && ((averages) >= 1) && \
+			((STATIC_SAMPLES(resolution, averages) % 16) == 0) && (STATIC_SAMPLES(resolution, averages) >= 16) && (STATIC_SAMPLES(resolution, averages) < 65536) && \
+			((channel) >= 0) && ((channel) < NUMBER_OF_CHANNELS)) ? 1 : -1];
+	A2D_STATIC_CHANNELS
+	#undef A2D_CHANNEL
+	typedef char STATIC_CHECK_WEIGHT_AD1[(STATIC_WEIGHT_AD1 <= MAX_SCHEDULE_SIZE) ? 1 : -1];
+	typedef char STATIC_CHECK_WEIGHT_AD2[(STATIC_WEIGHT_AD2 <= MAX_SCHEDULE_SIZE) ? 1 : -1];
+#else
+	struct A2D_Channel_Config channelConfig[CHANNELS_USED];
+#endif
+struct A2D_Channel_Attributes
+{
+	unsigned long roundingOffset;			//Half the divisor when rounding, otherwise 0 (truncation)
+	unsigned char rounding;					//1 = Round to nearest, 0 = Truncate (Default)
+	unsigned int samplesTaken;				//Current number of samples towards the next average
+	int value;								//The most current averaged value, includes resolution increase if used
+	#ifdef A2D_LAZY_FORMATTING
+		int rawValue;						//Lazy formatting: the averaged value before it has been through formatPointer
+		unsigned char lazyFormatting;		//1 = formatPointer is called by A2D_Value() when needed, 0 = As every value is published (Default)
+		unsigned char formatPending;		//Lazy formatting: 1 = rawValue is newer than value
+	#endif
+	#ifdef A2D_ADAPTIVE
+		unsigned char adaptiveMaximumStep;	//Adaptive: the most the resolution may be stepped down (0 = Not adaptive)
+		unsigned char adaptiveStep;			//Adaptive: bits the resolution is currently stepped down by, each one is 4x fewer samples
+		unsigned char adaptiveSteady;		//Adaptive: 1 = No transient since the block started
+		unsigned char adaptiveLastCount;	//Adaptive: samples of the channel in the previous burst
+		unsigned int adaptiveLastSum;		//Adaptive: sum of the channel samples in the previous burst
+		unsigned int adaptiveThreshold;		//Adaptive: change in the burst average (raw counts) that counts as a transient
+	#endif
+	#ifdef A2D_FILTERS
+		unsigned char filter;				//enum SPIKE_FILTER, applied to the raw samples of every burst before anything else sees them
+		unsigned char filterParameter;		//Median window, samples trimmed from each end, or the rejection limit in quarters of a sigma
+	#endif
+	#ifdef A2D_CALIBRATION
+		unsigned char calibrated;			//1 = Values go through the offset, gain and table below before they are published
+		int calibrationOffset;				//Counts added to the value before the gain
+		unsigned int calibrationGain;		//Fixed point gain, A2D_UNITY_GAIN = 1.0
+		const int *calibrationTable;		//Outputs at evenly spaced inputs, interpolated between ((void*)0 = No table)
+		unsigned char calibrationShift;		//Right shift that turns a value into its table segment (the segments are 2^shift counts wide)
+	#endif
+	#if defined(A2D_GATING) && defined(A2D_TIMESTAMP)
+		unsigned long refreshInterval;		//Gated: A2D_TIMESTAMP() ticks from one automatic request to the next (0 = Only on A2D_Request())
+		unsigned long requestTime;			//Gated: A2D_TIMESTAMP() of the last request
+	#endif
+	#ifdef A2D_DEADLINES
+		unsigned long deadline;				//Longest acceptable time between values, in A2D_Planner_Burst_Time() ticks (0 = No deadline)
+	#endif
+	#ifdef A2D_EVENTS
+		unsigned char eventRule;			//enum EVENT_RULE, decides which values are worth calling finishedFunction for
+		unsigned char eventActive;			//1 = The rule has fired and not yet re-armed (EVENT_CHANGE: 1 = eventReference is valid)
+		unsigned int eventLimit;			//Threshold, bottom of the window or the change required (counts before formatting)
+		unsigned int eventUpperLimit;		//Top of the window
+		unsigned int eventHysteresis;		//How far back past the limit the value has to go before the rule re-arms
+		unsigned int eventReference;		//EVENT_CHANGE: the value the finished function was last called for
+	#endif
+	unsigned int sequence;					//Incremented every time a new value is published
+	unsigned long sumOfSamples;				//Sum of all the A2D samples before it undergoes DSP/Averaging
+	unsigned int samplesPerBlock;			//Samples summed before the sum is used, samplesRequired unless the channel is streaming
+	#ifdef A2D_STREAMING
+		unsigned long *streamSegments;		//Streaming: ring of block sums (supplied by the caller) that make up the sliding window
+		unsigned long streamSum;			//Streaming: total of every block in the window
+		unsigned char streamSize;			//Streaming: number of segments supplied
+		unsigned char streamLength;			//Streaming: number of segments in use (the largest that splits samplesRequired evenly)
+		unsigned char streamIndex;			//Streaming: oldest segment, the next one to be replaced
+		unsigned char streamFilled;			//Streaming: number of segments collected since the window was last emptied
+	#endif
+	#ifdef A2D_CAPTURE
+		unsigned int *captureBuffer;		//Capture: ring of raw samples or values (supplied by the caller), (void*)0 = Not capturing
+		unsigned int captureLength;			//Capture: number of entries in the ring
+		unsigned int captureHead;			//Capture: where the next entry goes, the oldest entry once the ring has filled
+		unsigned int captureFilled;			//Capture: entries recorded so far, up to captureLength
+		unsigned int captureRemaining;		//Capture: entries still to be recorded after the trigger
+		unsigned int captureAfter;			//Capture: entries recorded after the trigger before the ring is frozen
+		unsigned int captureBelow;			//Capture: an entry below this triggers the capture
+		unsigned int captureAbove;			//Capture: an entry above this triggers the capture
+		unsigned char captureSource;		//enum CAPTURE_SOURCE
+		volatile unsigned char captureState;	//enum CAPTURE_STATE
+	#endif
+} A2D_Channel[CHANNELS_USED];
+
+#ifdef A2D_FILTERS
+//Sorting networks for the spike filters, each pair is a compare and swap so the cost is the same whatever the samples are
+const unsigned char sortNetwork3[][2] = {{0,2}, {0,1}, {1,2}};
+const unsigned char sortNetwork5[][2] = {{0,3}, {1,4}, {0,2}, {1,3}, {0,1}, {2,4}, {1,2}, {3,4}, {2,3}};
+const unsigned char sortNetwork8[][2] =	//19 comparators, 6 layers
+{
+	{0,2}, {1,3}, {4,6}, {5,7}, {0,4}, {1,5}, {2,6}, {3,7}, {0,1}, {2,3}, {4,5}, {6,7}, {2,4}, {3,5}, {1,4}, {3,6}, {1,2}, {3,4}, {5,6}
+};
+const unsigned char sortNetwork16[][2] =	//60 comparators, 10 layers
+{
+	{0,13}, {1,12}, {2,15}, {3,14}, {4,8}, {5,6}, {7,11}, {9,10},
+	{0,5}, {1,7}, {2,9}, {3,4}, {6,13}, {8,14}, {10,15}, {11,12},
+	{0,1}, {2,3}, {4,5}, {6,8}, {7,9}, {10,11}, {12,13}, {14,15},
+	{0,2}, {1,3}, {4,10}, {5,11}, {6,7}, {8,9}, {12,14}, {13,15},
+	{1,2}, {3,12}, {4,6}, {5,7}, {8,10}, {9,11}, {13,14},
+	{1,4}, {2,6}, {5,8}, {7,10}, {9,13}, {11,14},
+	{2,4}, {3,6}, {9,12}, {11,13},
+	{3,5}, {6,8}, {7,9}, {10,12},
+	{3,4}, {5,6}, {7,8}, {9,10}, {11,12},
+	{6,7}, {8,9}
+};
+#endif
+
+#ifdef A2D_TELEMETRY
+	struct A2D_Telemetry telemetry;
+	struct A2D_Channel_Telemetry channelTelemetry[CHANNELS_USED];
+	struct
+	{
+		unsigned int minimum;				//Smallest raw sample since the last published value
+		unsigned int maximum;				//Largest raw sample since the last published value
+		unsigned long sum;					//Sum of the raw samples since the last published value
+		unsigned long long sumOfSquares;	//Sum of the squared raw samples since the last published value
+		unsigned int count;					//Raw samples since the last published value
+		unsigned long lastPublished;		//A2D_TIMESTAMP() of the last published value
+	} channelWindow[CHANNELS_USED];
+	unsigned long burstTime;				//A2D_TIMESTAMP() of the burst A2D_Routine() is working through
+	unsigned long rawSum[CHANNELS_USED];				//Raw sum behind the last published value (for the variance)
+	unsigned long long rawSumOfSquares[CHANNELS_USED];	//Raw sum of squares behind the last published value (for the variance)
+#endif
+
+/*************Function  Prototypes***************/
+int Change_To_Analog(int pin);
+int Change_To_Digital(int pin);
+int Set_Scan_Mask(struct A2D_Module *module, A2D_CHANNEL_MASK mask);
+void Compile_Schedule(struct A2D_Module *module);
+void Select_Slot(struct A2D_Module *module, int slot);
+void Begin_Burst(struct A2D_Module *module);
+void End_Burst(struct A2D_Module *module);
+void Push_Burst(struct A2D_Module *module);
+void Service_Interrupt(struct A2D_Module *module);
+int Next_Active_Slot(struct A2D_Module *module, int slot);
+unsigned long Conversion_Cycles(struct A2D_Module *module);
+void Stop_Module(struct A2D_Module *module);
+#ifdef A2D_GATING
+	void Restart_Average(int channel);
+#endif
+void Demultiplex(struct A2D_Module *module, int slot, unsigned int *samples, int count);
+void Process_Channel(int channel, unsigned int *samples, int stride, int count);
+void Call_Finished_Functions(void);
+void Accumulate_Samples(int channel, unsigned int *samples, int stride, int count);
+void Finish_Average(int channel, unsigned long sum);
+unsigned long Decimate(int channel, unsigned long sum);
+#ifndef A2D_STATIC_CHANNELS
+	void Configure_Decimation(int channel);
+#endif
+void Configure_Rounding(int channel);
+#ifdef A2D_STREAMING
+	unsigned long Slide_Window(int channel, unsigned long sum);
+#endif
+#ifdef A2D_EVENTS
+	int Event_Due(int index, unsigned long value);
+#endif
+#ifdef A2D_ADAPTIVE
+	void Adapt_Oversampling(int channel, unsigned int *samples, int stride, int count);
+	void Set_Adaptive_Step(int index, unsigned char step);
+#endif
+#ifdef A2D_FILTERS
+	void Filter_Samples(int channel, unsigned int *samples, int stride, int count, unsigned int *filtered);
+	void Sort_Network(unsigned int *values, const unsigned char (*network)[2], int comparators);
+	void Sort_Burst(unsigned int *values, int count);
+#endif
+#ifdef A2D_CALIBRATION
+	void Calibrate_Array(int index, const unsigned int *raw, int *calibrated, int count, int stride);
+#endif
+#ifdef A2D_CAPTURE
+	void Capture(int index, unsigned int *entries, int stride, int count);
+#endif
+unsigned long Predict_Period(int channel, unsigned long samples);
+#ifdef A2D_DEADLINES
+	A2D_CHANNEL_MASK Missed_Deadlines(void);
+#endif
+void Configure_Streaming(int channel);
+#ifdef A2D_TIMESTAMP
+	void Measure_Jitter(struct A2D_Module *module, unsigned long burstEnd);
+	void Clear_Jitter(struct A2D_Module *module);
+#endif
+#if defined(A2D_GATING) && defined(A2D_TIMESTAMP)
+	void Refresh_Channels(void);
+#endif
+#ifdef A2D_TELEMETRY
+	void Measure_Time(unsigned long start, unsigned long *last, unsigned long *maximum);
+	void Sample_Statistics(int channel, unsigned int *samples, int stride, int count);
+	void Publish_Statistics(int channel);
+	void Reset_Window(int channel);
+#endif
+void A2D_INTERRUPT_ATTRIBUTES _ADC1Interrupt(void);
+#if A2D_NUMBER_OF_MODULES > 1
+	void A2D_INTERRUPT_ATTRIBUTES _ADC2Interrupt(void);
+#endif
+
+void A2D_Routine(void)
+{
+	struct A2D_Module *module;
+	struct A2D_Burst *burst;
+	int number;
+	int offset;
+	int slot;
+	int waiting = 0;
+	#ifdef A2D_TELEMETRY
+		unsigned long routineStart = A2D_TIMESTAMP();
+	#endif
+
+	for(number = 0; number < A2D_NUMBER_OF_MODULES; number++)
+		if(modules[number].burstTail != modules[number].burstHead)
+			waiting = 1;
+
+	if(waiting)
+	{
+		//Readers that interrupt us can tell the values are part way through being updated (seqlock)
+		publishSequence++;
+
+		//Drain every burst the ISRs have handed over, the scan restarts on each interrupt so each interrupt's worth is demultiplexed separately
+		for(number = 0; number < A2D_NUMBER_OF_MODULES; number++)
+		{
+			module = &modules[number];
+			while(module->burstTail != module->burstHead)
+			{
+				burst = &module->burstRing[module->burstTail & BURST_RING_MASK];
+				#ifdef A2D_TELEMETRY
+					burstTime = burst->timestamp;
+				#endif
+				for(offset = 0; offset < SCAN_BUFFER_SIZE; offset += module->samplesPerInterrupt)
+					Demultiplex(module, burst->slot, &burst->samples[offset], module->samplesPerInterrupt);
+
+				//Give the entry back to the ISR only once we are done with it
+				module->burstTail++;
+			}
+		}
+
+		publishSequence++;
+
+		//Every value is in place, now let the finished functions see a consistent set of them
+		Call_Finished_Functions();
+	}
+
+	//Gated channels whose refresh interval has run out ask for their next value
+	#if defined(A2D_GATING) && defined(A2D_TIMESTAMP)
+		if(refreshChannels != 0)
+			Refresh_Channels();
+	#endif
+
+	for(number = 0; number < A2D_NUMBER_OF_MODULES; number++)
+	{
+		module = &modules[number];
+
+		//Start the schedule from the top the first time through (or after it has changed, or been idle), as long as there is something to scan
+		if(module->burstChannelCount == 0)
+		{
+			slot = (module->scheduleLength != 0) ? Next_Active_Slot(module, 0) : -1;
+			if(slot < 0)
+			{
+				//Nothing is scheduled on the module, or every channel on it is gated and none of them are due
+				if(!module->idle)
+					Stop_Module(module);
+				continue;
+			}
+
+			Select_Slot(module, slot);
+			Set_Scan_Mask(module, module->scanSchedule[module->currentSlot].mask);
+			if(module->idle && (module->scanMode == SCAN_MODE_TIMED))
+			{
+				TMR3 = 0;
+				T3CONbits.TON = 1;				//1 = Starts 16-bit Timer3
+			}
+			module->idle = 0;
+
+			//From here on the ISR keeps the converter running by itself
+			if(module->scanMode != SCAN_MODE_ON_DEMAND)
+			{
+				Begin_Burst(module);
+				START_SCAN(module);
+			}
+		}
+
+		if((module->scanMode == SCAN_MODE_ON_DEMAND) && (module->burstChannelCount != 0))
+		{
+			//A request may have been met since the ISR picked the next burst, there is no point starting a burst nobody needs
+			#ifdef A2D_GATING
+				if((gatedChannels != 0) && !(*module->registers->control1 & CON1_ASAM))
+				{
+					slot = Next_Active_Slot(module, module->currentSlot);
+					if(slot < 0)
+					{
+						Stop_Module(module);
+						continue;
+					}
+					if(slot != module->currentSlot)
+					{
+						Select_Slot(module, slot);
+						Set_Scan_Mask(module, module->scanSchedule[module->currentSlot].mask);
+					}
+				}
+			#endif
+
+			//Perform the beginning of scan action if applicable
+			Begin_Burst(module);
+
+			//(Re)start the Automatic scanning of the Analog ports
+			START_SCAN(module);
+		}
+	}
+
+	#ifdef A2D_TELEMETRY
+		Measure_Time(routineStart, &telemetry.routineTime, &telemetry.maxRoutineTime);
+	#endif
+
+	return;
+}
+
+void Demultiplex(struct A2D_Module *module, int slot, unsigned int *samples, int count)
+{
+	unsigned char *channels = (unsigned char*)&module->scheduleChannels[module->scanSchedule[slot].first];
+	int channelCount = module->scanSchedule[slot].count;
+	int position;
+	int samplesEach;
+
+	//The module scans the selected channels in ascending order, starting over at the beginning of each interrupt
+	for(position = 0; position < channelCount; position++)
+	{
+		samplesEach = (count - position + channelCount - 1) / channelCount;
+		Process_Channel(channels[position], samples + position, channelCount, samplesEach);
+	}
+
+	return;
+}
+
+void Process_Channel(int channel, unsigned int *samples, int stride, int count)
+{
+	#ifdef A2D_FILTERS
+		unsigned int filtered[SCAN_BUFFER_SIZE];
+	#endif
+
+	//A channel scanned before A2D_Channel_Settings() has set it up has no block to collect towards
+	if(A2D_Channel[CHANNEL_INDEX(channel)].samplesPerBlock == 0)
+		return;
+
+	//A gated channel nobody is waiting on only shares a burst with channels that are due, its samples aren't wanted
+	#ifdef A2D_GATING
+		if(gatedChannels & ~dueChannels & MASK_BIT(channel))
+			return;
+	#endif
+
+	//The raw samples are captured before the spike filter has had a chance to hide anything
+	#ifdef A2D_CAPTURE
+		if((A2D_Channel[CHANNEL_INDEX(channel)].captureSource == CAPTURE_RAW_SAMPLES) && (A2D_Channel[CHANNEL_INDEX(channel)].captureBuffer != (void*)0))
+			Capture(CHANNEL_INDEX(channel), samples, stride, count);
+	#endif
+
+	//Spikes are taken out before anything else sees the samples, the burst keeps its number of samples so the decimation is unchanged
+	#ifdef A2D_FILTERS
+		if(A2D_Channel[CHANNEL_INDEX(channel)].filter != FILTER_NONE)
+		{
+			Filter_Samples(channel, samples, stride, count, filtered);
+			samples = filtered;
+			stride = 1;
+		}
+	#endif
+
+	#ifdef A2D_TELEMETRY
+		Sample_Statistics(channel, samples, stride, count);
+	#endif
+	#ifdef A2D_ADAPTIVE
+		if(A2D_Channel[CHANNEL_INDEX(channel)].adaptiveMaximumStep != 0)
+			Adapt_Oversampling(channel, samples, stride, count);
+	#endif
+	Accumulate_Samples(channel, samples, stride, count);
+
+	return;
+}
+
+void Call_Finished_Functions(void)
+{
+	int channel;
+
+	for(channel = 0; finishedChannels != 0; channel++)
+	{
+		if(finishedChannels & MASK_BIT(channel))
+		{
+			finishedChannels &= ~MASK_BIT(channel);
+			channelConfig[CHANNEL_INDEX(channel)].finishedFunction(channel);
+		}
+	}
+
+	return;
+}
+
+int A2D_Process_Burst(int channel, unsigned int *samples, int count)
+{
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel) || (count < 1) || (count > SCAN_BUFFER_SIZE))
+		return 0;
+
+	//Exactly what A2D_Routine() does with a burst that only held this channel
+	publishSequence++;
+	#ifdef A2D_TELEMETRY
+		burstTime = A2D_TIMESTAMP();
+	#endif
+	Process_Channel(channel, samples, 1, count);
+	publishSequence++;
+	Call_Finished_Functions();
+
+	return 1;
+}
+
+void Accumulate_Samples(int channel, unsigned int *samples, int stride, int count)
+{
+	int index = CHANNEL_INDEX(channel);
+	unsigned int chunk;
+	unsigned int sample;
+	unsigned long sum;
+
+	while(count > 0)
+	{
+		//Never sum more than the block needs, the rest of the burst goes towards the next block
+		chunk = A2D_Channel[index].samplesPerBlock - A2D_Channel[index].samplesTaken;
+		if(chunk > (unsigned int)count)
+			chunk = count;
+		count -= chunk;
+
+		//Add all of the samples into the raw variable
+		A2D_Channel[index].samplesTaken += chunk;
+		for(sample = 0; sample < chunk; sample++, samples += stride)
+			A2D_Channel[index].sumOfSamples += *samples;
+
+		//Check if we are ready for DSP/averaging
+		if(A2D_Channel[index].samplesTaken >= A2D_Channel[index].samplesPerBlock)
+		{
+			//House keeping - Reset the counter and storage variable
+			sum = A2D_Channel[index].sumOfSamples;
+			A2D_Channel[index].samplesTaken = 0;
+			A2D_Channel[index].sumOfSamples = 0;
+
+			//Coarse blocks are scaled up to the full resolution, the value keeps the same scale at every step
+			#ifdef A2D_ADAPTIVE
+				if(A2D_Channel[index].adaptiveMaximumStep != 0)
+				{
+					sum <<= 2 * A2D_Channel[index].adaptiveStep;
+
+					//A whole block without a transient, step back up towards full resolution
+					if(A2D_Channel[index].adaptiveSteady && (A2D_Channel[index].adaptiveStep != 0))
+						Set_Adaptive_Step(index, A2D_Channel[index].adaptiveStep - 1);
+					A2D_Channel[index].adaptiveSteady = 1;
+				}
+			#endif
+
+			//Streaming channels slide their window along by one block, there is nothing to publish until it has filled
+			#ifdef A2D_STREAMING
+				if(A2D_Channel[index].streamSegments != (void*)0)
+				{
+					sum = Slide_Window(channel, sum);
+					if(A2D_Channel[index].streamFilled < A2D_Channel[index].streamLength)
+						continue;
+				}
+			#endif
+
+			Finish_Average(channel, sum);
+		}
+	}
+
+	return;
+}
+
+void Finish_Average(int channel, unsigned long sum)
+{
+	int index = CHANNEL_INDEX(channel);
+	#if defined(A2D_CAPTURE) || defined(A2D_CALIBRATION)
+		unsigned int average;
+	#endif
+	int value;
+
+	#ifdef A2D_TELEMETRY
+		Publish_Statistics(channel);
+	#endif
+
+	//Perform the DSP/averaging
+	sum = Decimate(channel, sum); //Create average DSP value
+
+	//Calibration comes before any formatting, values are captured before either
+	#if defined(A2D_CAPTURE) || defined(A2D_CALIBRATION)
+		average = (unsigned int)sum;
+	#endif
+	#ifdef A2D_CAPTURE
+		if((A2D_Channel[index].captureSource == CAPTURE_VALUES) && (A2D_Channel[index].captureBuffer != (void*)0))
+			Capture(index, &average, 1, 1);
+	#endif
+	value = (int)sum;
+	#ifdef A2D_CALIBRATION
+		if(A2D_Channel[index].calibrated)
+			Calibrate_Array(index, &average, &value, 1, 1);
+	#endif
+
+	//Apply formats externaly if required
+	if(*channelConfig[index].formatPointer == NO_FORMATING)
+		A2D_Channel[index].value = value;
+	#ifdef A2D_LAZY_FORMATTING
+		else if(A2D_Channel[index].lazyFormatting)
+		{
+			//Leave the formatting for whenever (if ever) the value is read, the raw value is in place before it is flagged
+			A2D_Channel[index].rawValue = value;
+			A2D_Channel[index].formatPending = 1;
+		}
+	#endif
+	else
+		A2D_Channel[index].value = channelConfig[index].formatPointer(value);
+
+	A2D_Channel[index].sequence++;
+
+	//The request of a gated channel has been met, it isn't scanned again until the next one
+	#ifdef A2D_GATING
+		dueChannels &= ~MASK_BIT(channel);
+	#endif
+
+	//Perform the new reading function action if applicable (and the value is worth reporting), once every burst waiting has been processed
+	#ifdef A2D_EVENTS
+		if((*channelConfig[index].finishedFunction != NO_FINISHED_FUNCTION) && Event_Due(index, sum))
+	#else
+		if(*channelConfig[index].finishedFunction != NO_FINISHED_FUNCTION)
+	#endif
+			finishedChannels |= MASK_BIT(channel);
+
+	return;
+}
+
+#ifdef A2D_ADAPTIVE
+void Adapt_Oversampling(int channel, unsigned int *samples, int stride, int count)
+{
+	int index = CHANNEL_INDEX(channel);
+	unsigned int sum = 0;
+	int sample;
+	long change;
+	long limit;
+
+	for(sample = 0; sample < count; sample++, samples += stride)
+		sum += *samples;
+
+	//Compare the average of this burst with the last one, cross multiplied so there is no division
+	if((A2D_Channel[index].adaptiveLastCount != 0) && (count != 0))
+	{
+		change = (long)sum * A2D_Channel[index].adaptiveLastCount - (long)A2D_Channel[index].adaptiveLastSum * count;
+		limit = (long)A2D_Channel[index].adaptiveThreshold * count * A2D_Channel[index].adaptiveLastCount;
+		if((change > limit) || (-change > limit))
+		{
+			//Drop straight to the coarsest (fastest) step, the partial block is from before the transient so it is thrown away
+			A2D_Channel[index].adaptiveSteady = 0;
+			if(A2D_Channel[index].adaptiveStep != A2D_Channel[index].adaptiveMaximumStep)
+			{
+				Set_Adaptive_Step(index, A2D_Channel[index].adaptiveMaximumStep);
+				A2D_Channel[index].samplesTaken = 0;
+				A2D_Channel[index].sumOfSamples = 0;
+			}
+		}
+	}
+
+	A2D_Channel[index].adaptiveLastSum = sum;
+	A2D_Channel[index].adaptiveLastCount = count;
+
+	return;
+}
+
+void Set_Adaptive_Step(int index, unsigned char step)
+{
+	//Each bit of resolution given up is a quarter of the samples (samplesRequired is always a multiple of 4^b)
+	A2D_Channel[index].adaptiveStep = step;
+	A2D_Channel[index].samplesPerBlock = channelConfig[index].samplesRequired >> (2 * step);
+
+	return;
+}
+
+int A2D_Channel_Adaptive(int channel, enum RESOLUTION minimumResolution, unsigned int threshold)
+{
+	int index;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+	index = CHANNEL_INDEX(channel);
+
+	//The resolution can only be stepped down from the one in the channel settings
+	if((minimumResolution < RESOLUTION_10_BIT) || (minimumResolution > channelConfig[index].bitsOfResolutionIncrease))
+		return 0;
+
+	//A streaming window needs a fixed block size, the channel has to stop streaming first
+	#ifdef A2D_STREAMING
+		if(A2D_Channel[index].streamSegments != (void*)0)
+			return 0;
+	#endif
+
+	//Start over at full resolution
+	A2D_Channel[index].adaptiveMaximumStep = channelConfig[index].bitsOfResolutionIncrease - minimumResolution;
+	A2D_Channel[index].adaptiveThreshold = threshold;
+	A2D_Channel[index].adaptiveSteady = 1;
+	A2D_Channel[index].adaptiveLastCount = 0;
+	A2D_Channel[index].sumOfSamples = 0;
+	A2D_Channel[index].samplesTaken = 0;
+	Set_Adaptive_Step(index, 0);
+
+	return 1;
+}
+#endif
+
+int A2D_Channel_Resolution(int channel)
+{
+	int index;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return -1;
+	index = CHANNEL_INDEX(channel);
+
+	#ifdef A2D_ADAPTIVE
+		return channelConfig[index].bitsOfResolutionIncrease - A2D_Channel[index].adaptiveStep;
+	#else
+		return channelConfig[index].bitsOfResolutionIncrease;
+	#endif
+}
+
+#ifdef A2D_FILTERS
+void Filter_Samples(int channel, unsigned int *samples, int stride, int count, unsigned int *filtered)
+{
+	int index = CHANNEL_INDEX(channel);
+	int parameter = A2D_Channel[index].filterParameter;
+	unsigned int raw[SCAN_BUFFER_SIZE];
+	unsigned int window[5];
+	unsigned int rejected = 0;
+	unsigned int replacement;
+	unsigned long sum = 0;
+	unsigned long sumOfSquares = 0;
+	unsigned long variance;
+	unsigned long limit;
+	unsigned long keptSum;
+	long distance;
+	int kept;
+	int start;
+	int sample;
+
+	for(sample = 0; sample < count; sample++, samples += stride)
+		filtered[sample] = *samples;
+
+	switch(A2D_Channel[index].filter)
+	{
+		case FILTER_MEDIAN:
+			//Every sample becomes the median of the window around it, the windows at the ends of the burst are moved inwards so the first and last samples are covered too
+			if(count < parameter)
+				break;
+			for(sample = 0; sample < count; sample++)
+				raw[sample] = filtered[sample];
+			for(sample = 0; sample < count; sample++)
+			{
+				start = sample - parameter / 2;
+				if(start < 0)
+					start = 0;
+				else if(start > count - parameter)
+					start = count - parameter;
+				for(kept = 0; kept < parameter; kept++)
+					window[kept] = raw[start + kept];
+				if(parameter == 3)
+					Sort_Network(window, sortNetwork3, sizeof(sortNetwork3) / sizeof(sortNetwork3[0]));
+				else
+					Sort_Network(window, sortNetwork5, sizeof(sortNetwork5) / sizeof(sortNetwork5[0]));
+				filtered[sample] = window[parameter / 2];
+			}
+			break;
+		case FILTER_TRIMMED_MEAN:
+			//Short bursts (several channels per burst) always keep at least one sample
+			if(parameter > (count - 1) / 2)
+				parameter = (count - 1) / 2;
+			if(parameter == 0)
+				break;
+
+			//The order of the samples doesn't matter to anything after this, so they are sorted in place
+			Sort_Burst(filtered, count);
+			kept = count - 2 * parameter;
+			for(sample = parameter; sample < count - parameter; sample++)
+				sum += filtered[sample];
+
+			//The trimmed samples are replaced by the mean of the rest, the same as averaging the rest on their own
+			replacement = (unsigned int)((sum + kept / 2) / kept);
+			for(sample = 0; sample < parameter; sample++)
+			{
+				filtered[sample] = replacement;
+				filtered[count - 1 - sample] = replacement;
+			}
+			break;
+		case FILTER_SIGMA:
+			for(sample = 0; sample < count; sample++)
+			{
+				sum += filtered[sample];
+				sumOfSquares += (unsigned long)filtered[sample] * filtered[sample];
+			}
+
+			//Scaled by count^2 so there is no division or square root: |count*x - sum| * 4 > k * sqrt(count*sumOfSquares - sum^2), with k in quarters of a sigma
+			variance = count * sumOfSquares - sum * sum;
+			limit = (unsigned long)parameter * parameter;
+			if((variance == 0) || (variance > 0xFFFFFFFFul / limit))
+				break;//Nothing can be far enough out (16*distance^2 of 10-bit samples is always less than 2^32)
+			limit *= variance;
+
+			//Every sample is measured from the mean of the whole burst, only then are the rejected ones taken out of it
+			kept = count;
+			keptSum = sum;
+			for(sample = 0; sample < count; sample++)
+			{
+				distance = (long)count * filtered[sample] - (long)sum;
+				if(16ul * (unsigned long)(distance * distance) > limit)
+				{
+					rejected |= 1u << sample;
+					keptSum -= filtered[sample];
+					kept--;
+				}
+			}
+
+			//Rejected samples are replaced by the mean of the samples that were kept, with none kept (eg a two level burst) the burst is left as it is
+			if((rejected == 0) || (kept == 0))
+				break;
+			replacement = (unsigned int)((keptSum + kept / 2) / kept);
+			for(sample = 0; sample < count; sample++)
+				if(rejected & (1u << sample))
+					filtered[sample] = replacement;
+			break;
+		default:
+			break;
+	}
+
+	return;
+}
+
+void Sort_Network(unsigned int *values, const unsigned char (*network)[2], int comparators)
+{
+	unsigned int low;
+	int comparator;
+
+	for(comparator = 0; comparator < comparators; comparator++)
+	{
+		low = values[network[comparator][0]];
+		if(low > values[network[comparator][1]])
+		{
+			values[network[comparator][0]] = values[network[comparator][1]];
+			values[network[comparator][1]] = low;
+		}
+	}
+
+	return;
+}
+
+void Sort_Burst(unsigned int *values, int count)
+{
+	unsigned int padded[SCAN_BUFFER_SIZE];
+	int sample;
+
+	//A full burst sorts in place, anything shorter is padded out to the next network with values that sort to the top
+	if(count == SCAN_BUFFER_SIZE)
+	{
+		Sort_Network(values, sortNetwork16, sizeof(sortNetwork16) / sizeof(sortNetwork16[0]));
+		return;
+	}
+
+	for(sample = 0; sample < SCAN_BUFFER_SIZE; sample++)
+		padded[sample] = (sample < count) ? values[sample] : 0xFFFF;
+	if(count <= HALF_BUFFER_SIZE)
+		Sort_Network(padded, sortNetwork8, sizeof(sortNetwork8) / sizeof(sortNetwork8[0]));
+	else
+		Sort_Network(padded, sortNetwork16, sizeof(sortNetwork16) / sizeof(sortNetwork16[0]));
+	for(sample = 0; sample < count; sample++)
+		values[sample] = padded[sample];
+
+	return;
+}
+
+int A2D_Channel_Filter(int channel, enum SPIKE_FILTER filter, int parameter)
+{
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+
+	//Range checking
+	if(((filter == FILTER_MEDIAN) && (parameter != 3) && (parameter != 5)) ||
+		((filter == FILTER_TRIMMED_MEAN) && ((parameter < 1) || (parameter > 7))) ||
+		((filter == FILTER_SIGMA) && ((parameter < 1) || (parameter > 63))) ||
+		((filter != FILTER_NONE) && (filter != FILTER_MEDIAN) && (filter != FILTER_TRIMMED_MEAN) && (filter != FILTER_SIGMA)))
+		return 0;
+
+	A2D_Channel[CHANNEL_INDEX(channel)].filter = filter;
+	A2D_Channel[CHANNEL_INDEX(channel)].filterParameter = (filter == FILTER_NONE) ? 0 : parameter;
+
+	return 1;
+}
+#endif
+
+#ifdef A2D_CALIBRATION
+void Calibrate_Array(int index, const unsigned int *raw, int *calibrated, int count, int stride)
+{
+	const int *table = A2D_Channel[index].calibrationTable;
+	long offset = A2D_Channel[index].calibrationOffset;
+	unsigned long gain = A2D_Channel[index].calibrationGain;
+	long maximum = (long)channelConfig[index].maximumValue;
+	unsigned char shift;
+	unsigned int fractionMask;
+	unsigned int segment;
+	long corrected;
+	int position;
+	int last = count * stride;
+
+	//Offset and gain, each value on its own with nothing but clamps so a host compiler can vectorize the loop
+	for(position = 0; position < last; position += stride)
+	{
+		corrected = (long)raw[position] + offset;
+		corrected = (corrected < 0) ? 0 : (corrected > 0xFFFF) ? 0xFFFF : corrected;	//Keeps the product within 32 bits
+		corrected = (long)(((unsigned long)corrected * gain + (1ul << (GAIN_FRACTION_BITS - 1))) >> GAIN_FRACTION_BITS);
+		calibrated[position] = (int)((corrected > maximum) ? maximum : corrected);
+	}
+
+	//Then the table, the segments are a power of two wide so finding one is a shift and interpolating is a multiply
+	if(table != (void*)0)
+	{
+		//With a table the shift is at most 15 (2 segments of a 16-bit range)
+		shift = A2D_Channel[index].calibrationShift;
+		fractionMask = (1u << shift) - 1;
+		for(position = 0; position < last; position += stride)
+		{
+			segment = (unsigned int)calibrated[position] >> shift;
+			calibrated[position] = (int)(table[segment] + ((((long)table[segment + 1] - table[segment]) * ((unsigned int)calibrated[position] & fractionMask)) >> shift));
+		}
+	}
+
+	return;
+}
+
+int A2D_Channel_Calibration(int channel, int offset, unsigned int gain, const int *table, int segments)
+{
+	int index;
+	unsigned char shift;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+	index = CHANNEL_INDEX(channel);
+
+	//Range checking - The table has to split the range of the channel into 2 to 256 segments, a power of two
+	shift = ADC_RESOLUTION + channelConfig[index].bitsOfResolutionIncrease;
+	if(table != (void*)0)
+	{
+		if((segments < 2) || (segments > 256) || (segments & (segments - 1)))
+			return 0;
+		while(segments > 1)
+		{
+			segments >>= 1;
+			shift--;
+		}
+	}
+
+	//Published values pick the new calibration up from the next one on
+	A2D_Channel[index].calibrationOffset = offset;
+	A2D_Channel[index].calibrationGain = gain;
+	A2D_Channel[index].calibrationTable = table;
+	A2D_Channel[index].calibrationShift = shift;
+	A2D_Channel[index].calibrated = (offset != 0) || (gain != A2D_UNITY_GAIN) || (table != (void*)0);
+
+	return 1;
+}
+
+int A2D_Calibrate(int channel, const unsigned int *raw, int *calibrated, int count)
+{
+	int index;
+	int position;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel) || (raw == (void*)0) || (calibrated == (void*)0) || (count < 0))
+		return 0;
+	index = CHANNEL_INDEX(channel);
+
+	//The same as A2D_Routine() does when the value is published
+	if(A2D_Channel[index].calibrated)
+		Calibrate_Array(index, raw, calibrated, count, 1);
+	else
+		for(position = 0; position < count; position++)
+			calibrated[position] = (int)raw[position];
+
+	return 1;
+}
+
+int A2D_Calibrate_Channels(const unsigned char *channels, int numberOfChannels, const unsigned int *raw, int *calibrated, int records)
+{
+	int column;
+	int index;
+	int position;
+
+	//Range checking - Every channel has to be valid before anything is converted
+	if((channels == (void*)0) || (raw == (void*)0) || (calibrated == (void*)0) || (numberOfChannels < 1) || (records < 0))
+		return 0;
+	for(column = 0; column < numberOfChannels; column++)
+		if(!CHANNEL_IN_USE(channels[column]))
+			return 0;
+
+	//Each column is a channel, worked through a column at a time so the calibration of the channel stays put for the whole loop
+	for(column = 0; column < numberOfChannels; column++)
+	{
+		index = CHANNEL_INDEX(channels[column]);
+		if(A2D_Channel[index].calibrated)
+			Calibrate_Array(index, raw + column, calibrated + column, records, numberOfChannels);
+		else
+			for(position = column; position < records * numberOfChannels; position += numberOfChannels)
+				calibrated[position] = (int)raw[position];
+	}
+
+	return 1;
+}
+#endif
+
+#ifdef A2D_EVENTS
+int Event_Due(int index, unsigned long value)
+{
+	long distance;
+	int enter;
+	int leave;
+
+	switch(A2D_Channel[index].eventRule)
+	{
+		case EVENT_CHANGE:
+			//Only once the value has moved more than the limit away from the last one reported
+			distance = (long)value - (long)A2D_Channel[index].eventReference;
+			if(A2D_Channel[index].eventActive && (distance <= (long)A2D_Channel[index].eventLimit) && (-distance <= (long)A2D_Channel[index].eventLimit))
+				return 0;
+			A2D_Channel[index].eventActive = 1;
+			A2D_Channel[index].eventReference = value;
+			return 1;
+		case EVENT_ABOVE:
+			enter = value > A2D_Channel[index].eventLimit;
+			leave = (long)value < (long)A2D_Channel[index].eventLimit - (long)A2D_Channel[index].eventHysteresis;
+			break;
+		case EVENT_BELOW:
+			enter = value < A2D_Channel[index].eventLimit;
+			leave = value > (unsigned long)A2D_Channel[index].eventLimit + A2D_Channel[index].eventHysteresis;
+			break;
+		case EVENT_INSIDE:
+			enter = (value >= A2D_Channel[index].eventLimit) && (value <= A2D_Channel[index].eventUpperLimit);
+			leave = ((long)value < (long)A2D_Channel[index].eventLimit - (long)A2D_Channel[index].eventHysteresis) || (value > (unsigned long)A2D_Channel[index].eventUpperLimit + A2D_Channel[index].eventHysteresis);
+			break;
+		case EVENT_OUTSIDE:
+			enter = (value < A2D_Channel[index].eventLimit) || (value > A2D_Channel[index].eventUpperLimit);
+			leave = (value >= (unsigned long)A2D_Channel[index].eventLimit + A2D_Channel[index].eventHysteresis) && ((long)value <= (long)A2D_Channel[index].eventUpperLimit - (long)A2D_Channel[index].eventHysteresis);
+			break;
+		case EVENT_EVERY_VALUE:
+		default:
+			return 1;
+	}
+
+	//Fire once on the way in, then wait until the value has come back out past the hysteresis before firing again
+	if(!A2D_Channel[index].eventActive)
+	{
+		A2D_Channel[index].eventActive = enter;
+		return enter;
+	}
+	if(leave)
+		A2D_Channel[index].eventActive = 0;
+
+	return 0;
+}
+
+int A2D_Channel_Event(int channel, enum EVENT_RULE rule, unsigned int limit, unsigned int upperLimit, unsigned int hysteresis)
+{
+	int index;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel) || (rule < EVENT_EVERY_VALUE) || (rule > EVENT_CHANGE))
+		return 0;
+
+	//A window has to have a bottom below its top
+	if(((rule == EVENT_INSIDE) || (rule == EVENT_OUTSIDE)) && (limit > upperLimit))
+		return 0;
+
+	//Start disarmed, the next value is compared against the new rule from scratch
+	index = CHANNEL_INDEX(channel);
+	A2D_Channel[index].eventRule = rule;
+	A2D_Channel[index].eventLimit = limit;
+	A2D_Channel[index].eventUpperLimit = upperLimit;
+	A2D_Channel[index].eventHysteresis = hysteresis;
+	A2D_Channel[index].eventActive = 0;
+
+	return 1;
+}
+#endif
+
+#ifdef A2D_STREAMING
+unsigned long Slide_Window(int channel, unsigned long sum)
+{
+	int index = CHANNEL_INDEX(channel);
+	unsigned char segment = A2D_Channel[index].streamIndex;
+
+	//Swap the oldest block for the newest one, the running total always covers the last samplesRequired samples
+	A2D_Channel[index].streamSum += sum - A2D_Channel[index].streamSegments[segment];
+	A2D_Channel[index].streamSegments[segment] = sum;
+
+	if(++segment >= A2D_Channel[index].streamLength)
+		segment = 0;
+	A2D_Channel[index].streamIndex = segment;
+
+	if(A2D_Channel[index].streamFilled < A2D_Channel[index].streamLength)
+		A2D_Channel[index].streamFilled++;
+
+	return A2D_Channel[index].streamSum;
+}
+#endif
+
+void Configure_Streaming(int channel)
+{
+	int index = CHANNEL_INDEX(channel);
+	#ifdef A2D_STREAMING
+		unsigned char segment;
+	#endif
+
+	//Without a window the whole average is a single block
+	A2D_Channel[index].samplesPerBlock = channelConfig[index].samplesRequired;
+	#ifdef A2D_STREAMING
+		if(A2D_Channel[index].streamSegments == (void*)0)
+			return;
+
+		//Use as many segments as we were given, as long as they split the average evenly
+		A2D_Channel[index].streamLength = A2D_Channel[index].streamSize;
+		while((channelConfig[index].samplesRequired % A2D_Channel[index].streamLength) != 0)
+			A2D_Channel[index].streamLength--;
+		A2D_Channel[index].samplesPerBlock = channelConfig[index].samplesRequired / A2D_Channel[index].streamLength;
+
+		//Start with an empty window
+		for(segment = 0; segment < A2D_Channel[index].streamLength; segment++)
+			A2D_Channel[index].streamSegments[segment] = 0;
+		A2D_Channel[index].streamSum = 0;
+		A2D_Channel[index].streamIndex = 0;
+		A2D_Channel[index].streamFilled = 0;
+	#endif
+
+	return;
+}
+
+#ifdef A2D_STREAMING
+int A2D_Channel_Streaming(int channel, unsigned long *segments, int length)
+{
+	int index;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel) || (length < 0) || (length > 255))
+		return 0;
+	index = CHANNEL_INDEX(channel);
+
+	//A window of one segment is just the regular block average
+	if(length < 2)
+		segments = (void*)0;
+
+	//A streaming window needs a fixed block size, an adaptive channel has to be switched back to fixed first
+	#ifdef A2D_ADAPTIVE
+		if((segments != (void*)0) && (A2D_Channel[index].adaptiveMaximumStep != 0))
+			return 0;
+	#endif
+
+	A2D_Channel[index].streamSegments = segments;
+	A2D_Channel[index].streamSize = length;
+	A2D_Channel[index].sumOfSamples = 0;
+	A2D_Channel[index].samplesTaken = 0;
+	Configure_Streaming(channel);
+
+	return 1;
+}
+#endif
+
+#ifdef A2D_CAPTURE
+void Capture(int index, unsigned int *entries, int stride, int count)
+{
+	unsigned int *buffer = A2D_Channel[index].captureBuffer;
+	unsigned int head = A2D_Channel[index].captureHead;
+	unsigned char state = A2D_Channel[index].captureState;
+	int entry;
+
+	for(entry = 0; (entry < count) && (state != CAPTURE_FROZEN); entry++, entries += stride)
+	{
+		buffer[head] = *entries;
+		if(++head >= A2D_Channel[index].captureLength)
+			head = 0;
+		if(A2D_Channel[index].captureFilled < A2D_Channel[index].captureLength)
+			A2D_Channel[index].captureFilled++;
+
+		//Count down the entries after the trigger, or look for the trigger
+		if(state == CAPTURE_TRIGGERED)
+		{
+			if(--A2D_Channel[index].captureRemaining == 0)
+				state = CAPTURE_FROZEN;
+		}
+		else if((*entries < A2D_Channel[index].captureBelow) || (*entries > A2D_Channel[index].captureAbove))
+		{
+			A2D_Channel[index].captureRemaining = A2D_Channel[index].captureAfter;
+			state = (A2D_Channel[index].captureAfter != 0) ? CAPTURE_TRIGGERED : CAPTURE_FROZEN;
+		}
+	}
+
+	A2D_Channel[index].captureHead = head;
+	A2D_Channel[index].captureState = state;
+
+	return;
+}
+
+int A2D_Channel_Capture(int channel, unsigned int *buffer, int length, enum CAPTURE_SOURCE source, int afterTrigger, unsigned int below, unsigned int above)
+{
+	int index;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+	index = CHANNEL_INDEX(channel);
+
+	//Range checking
+	if((buffer != (void*)0) && ((length < 1) || (afterTrigger < 0) || (afterTrigger > length) || ((source != CAPTURE_RAW_SAMPLES) && (source != CAPTURE_VALUES))))
+		return 0;
+
+	//Stop recording while the ring is swapped over, then start again with it empty and armed
+	A2D_Channel[index].captureBuffer = (void*)0;
+	A2D_Channel[index].captureLength = length;
+	A2D_Channel[index].captureHead = 0;
+	A2D_Channel[index].captureFilled = 0;
+	A2D_Channel[index].captureAfter = afterTrigger;
+	A2D_Channel[index].captureBelow = below;
+	A2D_Channel[index].captureAbove = above;
+	A2D_Channel[index].captureSource = source;
+	A2D_Channel[index].captureState = CAPTURE_ARMED;
+	A2D_Channel[index].captureBuffer = buffer;
+
+	return 1;
+}
+
+int A2D_Capture_Trigger(int channel)
+{
+	int index;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+	index = CHANNEL_INDEX(channel);
+
+	//Only an armed capture can be triggered, a second trigger doesn't move the first
+	if((A2D_Channel[index].captureBuffer == (void*)0) || (A2D_Channel[index].captureState != CAPTURE_ARMED))
+		return 0;
+
+	A2D_Channel[index].captureRemaining = A2D_Channel[index].captureAfter;
+	A2D_Channel[index].captureState = (A2D_Channel[index].captureAfter != 0) ? CAPTURE_TRIGGERED : CAPTURE_FROZEN;
+
+	return 1;
+}
+
+int A2D_Capture_Read(int channel, const unsigned int **first, int *firstLength, const unsigned int **second, int *secondLength)
+{
+	int index;
+	unsigned int *buffer;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel) || (first == (void*)0) || (firstLength == (void*)0) || (second == (void*)0) || (secondLength == (void*)0))
+		return 0;
+	index = CHANNEL_INDEX(channel);
+	buffer = A2D_Channel[index].captureBuffer;
+
+	//Oldest first: until the ring has wrapped it is all in one piece from the start, after that it runs from the head around to just before it
+	*second = buffer;
+	*secondLength = 0;
+	if(buffer == (void*)0)
+	{
+		*first = (void*)0;
+		*firstLength = 0;
+	}
+	else if(A2D_Channel[index].captureFilled < A2D_Channel[index].captureLength)
+	{
+		*first = buffer;
+		*firstLength = A2D_Channel[index].captureFilled;
+	}
+	else
+	{
+		*first = buffer + A2D_Channel[index].captureHead;
+		*firstLength = A2D_Channel[index].captureLength - A2D_Channel[index].captureHead;
+		*secondLength = A2D_Channel[index].captureHead;
+	}
+
+	return (buffer != (void*)0) && (A2D_Channel[index].captureState == CAPTURE_FROZEN);
+}
+#endif
+
+unsigned long Decimate(int channel, unsigned long sum)
+{
+	int index = CHANNEL_INDEX(channel);
+	unsigned int multiplier = channelConfig[index].decimationMultiplier;
+	unsigned int divisor = channelConfig[index].decimationDivisor;
+	unsigned long quotient;
+	unsigned long remainder;
+
+	//Equivalent to sum / (numberOfAverages * 2^b), without the software division
+	sum = (sum + A2D_Channel[index].roundingOffset) >> channelConfig[index].decimationShift;
+	if(multiplier)
+	{
+		//sum * multiplier >> 16 as two 16x16 multiplies (the sum is below 2^26), then the rest of the shift
+		quotient = (unsigned long)(unsigned int)(sum >> 16) * multiplier + (((unsigned long)(unsigned int)(sum & 0xFFFF) * multiplier) >> 16);
+		quotient >>= channelConfig[index].reciprocalShift - 16;
+
+		//The reciprocal is rounded down so the quotient is at most 2 short, the remainder puts it right
+		remainder = sum - (unsigned long)(unsigned int)quotient * divisor;
+		while(remainder >= divisor)
+		{
+			quotient++;
+			remainder -= divisor;
+		}
+		sum = quotient;
+	}
+
+	//Rounding the very top readings up can overflow the requested resolution
+	if(sum > channelConfig[index].maximumValue)
+		sum = channelConfig[index].maximumValue;
+
+	return sum;
+}
+
+void Configure_Rounding(int channel)
+{
+	int index = CHANNEL_INDEX(channel);
+	unsigned long divisor;
+
+	//Half the divisor added before dividing rounds to the nearest count
+	divisor = (unsigned long)channelConfig[index].numberOfAverages << channelConfig[index].bitsOfResolutionIncrease;
+	A2D_Channel[index].roundingOffset = A2D_Channel[index].rounding ? (divisor >> 1) : 0;
+
+	return;
+}
+
+#ifndef A2D_STATIC_CHANNELS
+void Configure_Decimation(int channel)
+{
+	int index = CHANNEL_INDEX(channel);
+	unsigned long divisor;
+	unsigned long oddPart;
+	unsigned char bits;
+
+	//Static channels have all of this worked out by the compiler instead, see STATIC_DECIMATION_SHIFT() etc
+	divisor = (unsigned long)channelConfig[index].numberOfAverages << channelConfig[index].bitsOfResolutionIncrease;
+	if(divisor == 0)
+		return;//Not set up yet, A2D_Channel_Settings() will come back here
+	channelConfig[index].maximumValue = (1ul << (ADC_RESOLUTION + channelConfig[index].bitsOfResolutionIncrease)) - 1;
+
+	//The power of two part of the divisor is a plain shift
+	channelConfig[index].decimationShift = 0;
+	for(oddPart = divisor; !(oddPart & 1); oddPart >>= 1)
+		channelConfig[index].decimationShift++;
+
+	channelConfig[index].decimationDivisor = (unsigned int)oddPart;
+	if(oddPart == 1)
+	{
+		channelConfig[index].decimationMultiplier = 0;
+		channelConfig[index].reciprocalShift = 0;
+		return;
+	}
+
+	//The odd part becomes a multiply by floor(2^(15+L)/d) and a shift of 15+L, where L = ceil(log2(d)), so the multiplier
+	//is 16 bits (2^15 to 2^16 - 1). It is within 2^-15 of 1/d and the quotient is below 2^16, so the estimate is at most 2 short
+	for(bits = 0; (1ul << bits) < oddPart; bits++)
+		;
+	channelConfig[index].reciprocalShift = DECIMATION_PRECISION + bits;
+	channelConfig[index].decimationMultiplier = (unsigned int)((1ul << (DECIMATION_PRECISION + bits)) / oddPart);
+
+	return;
+}
+#endif
+
+int A2D_Channel_Rounding(int channel, int rounding)
+{
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+
+	A2D_Channel[CHANNEL_INDEX(channel)].rounding = rounding ? 1 : 0;
+	Configure_Rounding(channel);
+
+	return 1;
+}
+
+void Compile_Schedule(struct A2D_Module *module)
+{
+	int current[A2D_INPUTS_PER_MODULE];
+	unsigned char *weight = &scanWeight[module->firstChannel];
+	volatile unsigned char *channels = module->scheduleChannels;
+	int totalWeight = 0;
+	int input;
+	int channel;
+	int best;
+	int position;
+	int start;
+	int limit;
+	int sorted;
+	A2D_CHANNEL_MASK mask;
+	unsigned char swap;
+
+	//Nothing may be scanned from a half built schedule, so stop and let A2D_Routine() restart it afterwards
+	ENABLE_INTERRUPT(module, 0);
+	STOP_SCAN(module);
+	CLEAR_INTERRUPT(module);
+	module->halvesCollected = 0;
+	module->burstChannelCount = 0;
+	module->burstTail = module->burstHead;//Bursts already in the ring belong to the old schedule
+	#ifdef A2D_TIMESTAMP
+		Clear_Jitter(module);//The restart isn't part of the burst to burst timing
+	#endif
+
+	//Only the module's own inputs are scheduled on it
+	for(input = 0; input < A2D_INPUTS_PER_MODULE; input++)
+	{
+		current[input] = 0;
+		totalWeight += weight[input];
+	}
+
+	//Smooth weighted round robin - every step each channel gains its weight, the leader is scanned and pays back the total
+	//This spreads the repeats of a heavily weighted channel evenly through the cycle instead of clumping them together
+	for(position = 0; position < totalWeight; position++)
+	{
+		best = -1;
+		for(input = 0; input < A2D_INPUTS_PER_MODULE; input++)
+		{
+			if(weight[input] == 0)
+				continue;
+			current[input] += weight[input];
+			if((best == -1) || (current[input] > current[best]))
+				best = input;
+		}
+		current[best] -= totalWeight;
+		channels[position] = module->firstChannel + best;
+	}
+
+	//Every channel in a burst has to get at least one sample before the next interrupt
+	limit = module->channelsPerBurst;
+	if(limit > module->samplesPerInterrupt)
+		limit = module->samplesPerInterrupt;
+
+	//Cut the sequence into bursts of consecutive, non-repeating channels and precompute the CSSL (and CSSH) mask of each
+	module->scheduleLength = 0;
+	for(position = 0; position < totalWeight; )
+	{
+		start = position;
+		mask = 0;
+		while((position < totalWeight) && ((position - start) < limit) && !(mask & MASK_BIT(channels[position] - module->firstChannel)))
+			mask |= MASK_BIT(channels[position++] - module->firstChannel);
+
+		//The buffer fills in ascending channel order, so that is the order they are demultiplexed in
+		for(sorted = start + 1; sorted < position; sorted++)
+			for(channel = sorted; (channel > start) && (channels[channel - 1] > channels[channel]); channel--)
+			{
+				swap = channels[channel];
+				channels[channel] = channels[channel - 1];
+				channels[channel - 1] = swap;
+			}
+
+		module->scanSchedule[module->scheduleLength].mask = mask;
+		module->scanSchedule[module->scheduleLength].first = start;
+		module->scanSchedule[module->scheduleLength].count = position - start;
+		module->scheduleLength++;
+	}
+
+	module->currentSlot = 0;
+	ENABLE_INTERRUPT(module, 1);
+
+	return;
+}
+
+void Select_Slot(struct A2D_Module *module, int slot)
+{
+	//Everything about the burst was worked out when the schedule was compiled
+	module->currentSlot = slot;
+	module->burstChannels = &module->scheduleChannels[module->scanSchedule[slot].first];
+	module->burstChannelCount = module->scanSchedule[slot].count;
+
+	return;
+}
+
+void Begin_Burst(struct A2D_Module *module)
+{
+	volatile unsigned char *channels = module->burstChannels;
+	int position;
+
+	//Perform the beginning of scan action if applicable
+	for(position = 0; position < module->burstChannelCount; position++)
+		if(*channelConfig[CHANNEL_INDEX(channels[position])].preFunction != NO_PREFUNCTION)
+			channelConfig[CHANNEL_INDEX(channels[position])].preFunction(channels[position]);
+
+	return;
+}
+
+void End_Burst(struct A2D_Module *module)
+{
+	volatile unsigned char *channels = module->burstChannels;
+	int position;
+
+	//Perform the end of scan action if applicable
+	for(position = 0; position < module->burstChannelCount; position++)
+		if(*channelConfig[CHANNEL_INDEX(channels[position])].postFunction != NO_POSTFUNCTION)
+			channelConfig[CHANNEL_INDEX(channels[position])].postFunction(channels[position]);
+
+	return;
+}
+
+void A2D_INTERRUPT_ATTRIBUTES _ADC1Interrupt(void)
+{
+	Service_Interrupt(&modules[0]);
+
+	return;
+}
+
+#if A2D_NUMBER_OF_MODULES > 1
+void A2D_INTERRUPT_ATTRIBUTES _ADC2Interrupt(void)
+{
+	Service_Interrupt(&modules[1]);
+
+	return;
+}
+#endif
+
+void Service_Interrupt(struct A2D_Module *module)
+{
+	volatile unsigned int *half;
+	unsigned int *copy;
+	int buffer;
+	int slot;
+
+	#ifdef A2D_TIMESTAMP
+		unsigned long interruptStart = A2D_TIMESTAMP();
+	#endif
+
+	//Clear interrupt flag
+	CLEAR_INTERRUPT(module);
+
+	//Continuous and timed bursts both use the split buffer
+	if(module->scanMode != SCAN_MODE_ON_DEMAND)
+	{
+		//BUFS tells us which half the module has moved on to, the other half is ours to read
+		if(*module->registers->control2 & CON2_BUFS)
+			half = module->registers->buffer;
+		else
+			half = module->registers->buffer + HALF_BUFFER_SIZE;
+
+		//Claim a place in the ring at the start of a burst, if there isn't one the burst is dropped but the converter keeps going
+		if(module->halvesCollected == 0)
+			module->burstWriting = (unsigned char)(module->burstHead - module->burstTail) < BURST_RING_SIZE;
+
+		//Copy straight away, the module will be back to overwrite this half in another 8 samples
+		if(module->burstWriting)
+		{
+			copy = &module->burstRing[module->burstHead & BURST_RING_MASK].samples[module->halvesCollected * HALF_BUFFER_SIZE];
+			for(buffer = 0; buffer < HALF_BUFFER_SIZE; buffer++)
+				copy[buffer] = half[buffer];
+		}
+
+		//Each burst still gets 16 samples (two halves) before moving on
+		if(++module->halvesCollected < (SCAN_BUFFER_SIZE/HALF_BUFFER_SIZE))
+		{
+			#ifdef A2D_TELEMETRY
+				Measure_Time(interruptStart, &telemetry.interruptTime, &telemetry.maxInterruptTime);
+			#endif
+			return;
+		}
+		module->halvesCollected = 0;
+	}
+	else
+	{
+		//Temporarily turn off automatic scanning until A2D_Routine() asks for the next burst
+		STOP_SCAN(module);
+
+		//Copy the samples out so the buffer is free for the next burst
+		module->burstWriting = (unsigned char)(module->burstHead - module->burstTail) < BURST_RING_SIZE;
+		if(module->burstWriting)
+		{
+			copy = module->burstRing[module->burstHead & BURST_RING_MASK].samples;
+			for(buffer = 0; buffer < SCAN_BUFFER_SIZE; buffer++)
+				copy[buffer] = module->registers->buffer[buffer];
+		}
+	}
+
+	#ifdef A2D_TIMESTAMP
+		Measure_Jitter(module, interruptStart);
+	#endif
+
+	//Perform the end of scan action if applicable
+	End_Burst(module);
+
+	//Let the A2D routine know that we have finished
+	Push_Burst(module);
+
+	//Move straight onto the next burst that has a channel due, the converter only pauses for the ADON cycle that the CSSL change requires
+	slot = Next_Active_Slot(module, (module->currentSlot + 1 < module->scheduleLength) ? module->currentSlot + 1 : 0);
+	if(slot < 0)
+	{
+		//Nothing is due, A2D_Routine() starts the module back up once something is
+		Stop_Module(module);
+		#ifdef A2D_TELEMETRY
+			Measure_Time(interruptStart, &telemetry.interruptTime, &telemetry.maxInterruptTime);
+		#endif
+		return;
+	}
+	Select_Slot(module, slot);
+	Set_Scan_Mask(module, module->scanSchedule[module->currentSlot].mask);
+	if(module->scanMode != SCAN_MODE_ON_DEMAND)
+		Begin_Burst(module);
+
+	#ifdef A2D_TELEMETRY
+		Measure_Time(interruptStart, &telemetry.interruptTime, &telemetry.maxInterruptTime);
+	#endif
+
+	return;
+}
+
+int Next_Active_Slot(struct A2D_Module *module, int slot)
+{
+	#ifdef A2D_GATING
+		A2D_CHANNEL_MASK waiting = gatedChannels & ~dueChannels;
+		int checked;
+
+		//Nothing waiting on a request, every slot is scanned in turn
+		if(waiting == 0)
+			return slot;
+
+		//A slot is worth scanning if any channel in it is due (or isn't gated)
+		for(checked = 0; checked < module->scheduleLength; checked++)
+		{
+			if(((A2D_CHANNEL_MASK)module->scanSchedule[slot].mask << module->firstChannel) & ~waiting)
+				return slot;
+			slot = (slot + 1 < module->scheduleLength) ? slot + 1 : 0;
+		}
+
+		return -1;
+	#else
+		//Without gating every slot is scanned in turn, as long as there is a schedule
+		return (module->scheduleLength != 0) ? slot : -1;
+	#endif
+}
+
+void Stop_Module(struct A2D_Module *module)
+{
+	//Power the converter down (and Timer3 if it was triggering it), no interrupts until A2D_Routine() finds a slot that is due
+	STOP_SCAN(module);
+	MODULE_OFF(module);
+	CLEAR_INTERRUPT(module);
+	if(module->scanMode == SCAN_MODE_TIMED)
+		T3CONbits.TON = 0;				//0 = Stops 16-bit Timer3
+	module->halvesCollected = 0;
+	module->burstChannelCount = 0;
+	module->idle = 1;
+	#ifdef A2D_TIMESTAMP
+		Clear_Jitter(module);//The time spent idle isn't part of the burst to burst timing
+	#endif
+
+	return;
+}
+
+#ifdef A2D_GATING
+void Restart_Average(int channel)
+{
+	int index = CHANNEL_INDEX(channel);
+
+	//Throw the partial average (and window) away, the next value is made only from samples taken from here on
+	A2D_Channel[index].samplesTaken = 0;
+	A2D_Channel[index].sumOfSamples = 0;
+	#ifdef A2D_ADAPTIVE
+		A2D_Channel[index].adaptiveLastCount = 0;
+	#endif
+	#ifdef A2D_STREAMING
+		if(A2D_Channel[index].streamSegments != (void*)0)
+			Configure_Streaming(channel);
+	#endif
+
+	return;
+}
+
+int A2D_Channel_Gating(int channel, int gated)
+{
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+
+	//Either way the channel starts over without a request outstanding
+	dueChannels &= ~MASK_BIT(channel);
+	Restart_Average(channel);
+	if(gated)
+		gatedChannels |= MASK_BIT(channel);
+	else
+	{
+		gatedChannels &= ~MASK_BIT(channel);
+		refreshChannels &= ~MASK_BIT(channel);
+	}
+
+	return 1;
+}
+
+int A2D_Request(int channel)
+{
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+
+	//A channel that isn't gated is always being scanned, and one already due is on its way
+	if(!(gatedChannels & MASK_BIT(channel)) || (dueChannels & MASK_BIT(channel)))
+		return 1;
+
+	Restart_Average(channel);
+	#ifdef A2D_TIMESTAMP
+		A2D_Channel[CHANNEL_INDEX(channel)].requestTime = A2D_TIMESTAMP();
+	#endif
+	dueChannels |= MASK_BIT(channel);
+
+	return 1;
+}
+#endif
+
+int A2D_Idle(void)
+{
+	int number;
+
+	for(number = 0; number < A2D_NUMBER_OF_MODULES; number++)
+		if(!modules[number].idle)
+			return 0;
+
+	return 1;
+}
+
+#if defined(A2D_GATING) && defined(A2D_TIMESTAMP)
+void Refresh_Channels(void)
+{
+	A2D_CHANNEL_MASK pending = refreshChannels & ~dueChannels;
+	unsigned long now = A2D_TIMESTAMP();
+	int channel;
+
+	for(channel = 0; pending != 0; channel++)
+	{
+		if(pending & MASK_BIT(channel))
+		{
+			pending &= ~MASK_BIT(channel);
+			if(now - A2D_Channel[CHANNEL_INDEX(channel)].requestTime >= A2D_Channel[CHANNEL_INDEX(channel)].refreshInterval)
+				A2D_Request(channel);
+		}
+	}
+
+	return;
+}
+
+int A2D_Channel_Refresh_Interval(int channel, unsigned long interval)
+{
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+
+	//An interval implies gating, the first value is requested straight away
+	A2D_Channel[CHANNEL_INDEX(channel)].refreshInterval = interval;
+	if(interval == 0)
+		refreshChannels &= ~MASK_BIT(channel);
+	else
+	{
+		if(!(gatedChannels & MASK_BIT(channel)))
+			A2D_Channel_Gating(channel, 1);
+		refreshChannels |= MASK_BIT(channel);
+		A2D_Request(channel);
+	}
+
+	return 1;
+}
+#endif
+
+void Push_Burst(struct A2D_Module *module)
+{
+	struct A2D_Burst *burst = &module->burstRing[module->burstHead & BURST_RING_MASK];
+	unsigned char waiting;
+
+	if(!module->burstWriting)
+	{
+		module->droppedBursts++;
+		#ifdef A2D_TELEMETRY
+			for(waiting = 0; waiting < module->burstChannelCount; waiting++)
+				channelTelemetry[CHANNEL_INDEX(module->burstChannels[waiting])].overruns++;
+		#endif
+		return;
+	}
+
+	//Publish the burst, the samples were written before the head moves so the routine never sees a partial burst
+	burst->slot = module->currentSlot;
+	#ifdef A2D_TELEMETRY
+		burst->timestamp = A2D_TIMESTAMP();
+	#endif
+	module->burstHead++;
+
+	waiting = module->burstHead - module->burstTail;
+	if(waiting > module->burstHighWaterMark)
+		module->burstHighWaterMark = waiting;
+
+	return;
+}
+
+unsigned int A2D_Dropped_Bursts(void)
+{
+	return A2D_Module_Dropped_Bursts(0);
+}
+
+unsigned int A2D_Module_Dropped_Bursts(int module)
+{
+	//Range checking
+	if(!MODULE_IN_RANGE(module))
+		return 0;
+
+	return modules[module].droppedBursts;
+}
+
+int A2D_Burst_High_Water_Mark(void)
+{
+	return A2D_Module_Burst_High_Water_Mark(0);
+}
+
+int A2D_Module_Burst_High_Water_Mark(int module)
+{
+	//Range checking
+	if(!MODULE_IN_RANGE(module))
+		return 0;
+
+	return modules[module].burstHighWaterMark;
+}
+
+#ifdef A2D_TIMESTAMP
+void Measure_Jitter(struct A2D_Module *module, unsigned long burstEnd)
+{
+	struct A2D_Burst_Jitter *burstJitter = &module->burstJitter;
+	unsigned long interval;
+
+	//Time between the ends of consecutive bursts, the first burst after a restart has nothing to be measured from
+	if(module->lastBurstValid)
+	{
+		interval = burstEnd - module->lastBurstEnd;
+		if((burstJitter->intervals == 0) || (interval < burstJitter->minimumInterval))
+			burstJitter->minimumInterval = interval;
+		if(interval > burstJitter->maximumInterval)
+			burstJitter->maximumInterval = interval;
+		burstJitter->interval = interval;
+		burstJitter->intervals++;
+		module->intervalSum += interval;
+	}
+	module->lastBurstEnd = burstEnd;
+	module->lastBurstValid = 1;
+
+	return;
+}
+
+void Clear_Jitter(struct A2D_Module *module)
+{
+	struct A2D_Burst_Jitter cleared = {0};
+
+	module->burstJitter = cleared;
+	module->intervalSum = 0;
+	module->lastBurstValid = 0;
+
+	return;
+}
+
+void A2D_Burst_Jitter(struct A2D_Burst_Jitter *statistics)
+{
+	A2D_Module_Burst_Jitter(0, statistics);
+
+	return;
+}
+
+int A2D_Module_Burst_Jitter(int module, struct A2D_Burst_Jitter *statistics)
+{
+	//Range checking
+	if(!MODULE_IN_RANGE(module))
+		return 0;
+
+	*statistics = modules[module].burstJitter;
+
+	//Worked out here rather than on every burst
+	if(statistics->intervals)
+	{
+		statistics->averageInterval = (unsigned long)(modules[module].intervalSum / statistics->intervals);
+		statistics->jitter = statistics->maximumInterval - statistics->minimumInterval;
+	}
 
-/*************    Enumeration     ***************/
-/*************ArbitraryFunctionality*************/
-#define MAX_SCAN_QUEUE_SIZE	16	//Max size of the scan queue
+	return 1;
+}
 
-/************* Module Definitions ***************/
-#define	STOP_SCAN		AD1CON1bits.ASAM=0	//Stops the scanning of channels
-#define	START_SCAN		AD1CON1bits.ASAM=1	//Starts the scanning of channels
+void A2D_Reset_Jitter(void)
+{
+	A2D_Module_Reset_Jitter(0);
 
-/************* Other  Definitions ***************/
-/*************  Global Variables  ***************/
-volatile char scanningQueue[MAX_SCAN_QUEUE_SIZE]; //The list of channels to scan, as well as the order to scan them in
-volatile char scanIsComplete;
-volatile char currentQueueElement;
-struct A2D_Channel_Attributes
+	return;
+}
+
+int A2D_Module_Reset_Jitter(int module)
 {
-	unsigned char bitsOfResolutionIncrease;	//The number of bit of increased resolution (Default is 0 which is 10 bits)
-	unsigned int samplesRequired;			//The number of samples required to initate an averaging event (includes number of finished samples to make a final averaged sample)
-	unsigned int valueForDSP;				//Used as part of calculation to get the current value, includes what is required for resolution increasing as well as averaging
-	unsigned int samplesTaken;				//Current number of samples, in multiples of 16 (because samples are taken in bursts of 16)
-	int value;								//The most current averaged value, includes resolution increase if used
-	int (*formatPointer)(int);				//Used to specify a function that handles the formating of the averaged value
-	void (*preFunction)(int);				//Used to specify a function that activates when a channel starts being scanned (eg for setting a switched pin)
-	void (*postFunction)(int);				//Used to specify a function that activates when a channel stops being scanned (eg for resetting a switched pin)
-	void (*finishedFunction)(int);			//Used to specify a function that activates when a channel finishes being scanned and a new value is created (eg For setting flags for functions that need to run as soon as a value is determined)
-	unsigned long sumOfSamples;				//Sum of all the A2D samples before it undergoes DSP/Averaging
-} A2D_Channel[NUMBER_OF_CHANNELS];
+	//Range checking
+	if(!MODULE_IN_RANGE(module))
+		return 0;
 
-/*************Function  Prototypes***************/
-int Change_To_Analog(int pin);
-int Change_To_Digital(int pin);
-int Add_To_Scan(int pin);
-int Remove_From_Scan(int pin);
-int Find_Next_Queue_Element(int channel);
-void __attribute__((__interrupt__, auto_psv)) _ADC1Interrupt(void);
+	Clear_Jitter(&modules[module]);
 
-void A2D_Routine(void)
+	return 1;
+}
+#endif
+
+int A2D_Sample_Period(unsigned int cycles)
 {
-	int buffer;
+	//Range checking, Timer3 would start the next sample before the last one had finished converting
+	if(cycles < Conversion_Cycles(&modules[0]))
+		return 0;//Failure
 
-	if(scanIsComplete)
-	{
-		//Reset for next time
-		scanIsComplete = 0;
+	//Takes effect straight away if we are already timed (only AD1 can be)
+	samplePeriod = cycles;
+	if(modules[0].scanMode == SCAN_MODE_TIMED)
+		PR3 = samplePeriod - 1;
 
-		//Add all of the samples into the raw variable
-		for(buffer = 0; buffer < NUMBER_OF_CHANNELS; buffer++)
-			A2D_Channel[scanningQueue[currentQueueElement]].sumOfSamples += *(&ADC1BUF0 + buffer);
+	return 1;//Success
+}
 
-		//Increment the number of samples read in (we just took 16 samples in a burst, hence the +16)
-		A2D_Channel[scanningQueue[currentQueueElement]].samplesTaken += SCAN_BUFFER_SIZE;
+unsigned long Conversion_Cycles(struct A2D_Module *module)
+{
+	unsigned int control3 = *module->registers->control3;
+	unsigned long tad;
+	unsigned long samplingTad;
 
-		//Check if we are ready for DSP/averaging
-		if(A2D_Channel[scanningQueue[currentQueueElement]].samplesTaken >= A2D_Channel[scanningQueue[currentQueueElement]].samplesRequired)
-		{
-			//Perform the DSP/averaging
-			A2D_Channel[scanningQueue[currentQueueElement]].sumOfSamples /= A2D_Channel[scanningQueue[currentQueueElement]].valueForDSP; //Create average DSP value
+	//TAD is either the internal RC clock or (ADCS + 1) instruction cycles
+	if(control3 & CON3_ADRC)
+		tad = A2D_RC_TAD_CYCLES;
+	else
+		tad = (control3 & CON3_ADCS) + 1;
 
-			//Apply formats externaly if required
-			if(*A2D_Channel[scanningQueue[currentQueueElement]].formatPointer == NO_FORMATING)
-				A2D_Channel[scanningQueue[currentQueueElement]].value = (int)A2D_Channel[scanningQueue[currentQueueElement]].sumOfSamples;
-			else
-				A2D_Channel[scanningQueue[currentQueueElement]].value = A2D_Channel[scanningQueue[currentQueueElement]].formatPointer((int)A2D_Channel[scanningQueue[currentQueueElement]].sumOfSamples);
+	//Sampling is a minimum of 1 TAD
+	samplingTad = (control3 & CON3_SAMC) >> 8;
+	if(samplingTad == 0)
+		samplingTad = 1;
 
-			//House keeping - Reset the counter and storage variable
-			A2D_Channel[scanningQueue[currentQueueElement]].samplesTaken = 0;
-			A2D_Channel[scanningQueue[currentQueueElement]].sumOfSamples = 0;
+	return (samplingTad + CONVERSION_TAD) * tad;
+}
 
-			//Perform the new reading function action if applicable
-			if(*A2D_Channel[scanningQueue[currentQueueElement]].finishedFunction != NO_FINISHED_FUNCTION)
-				A2D_Channel[scanningQueue[currentQueueElement]].finishedFunction(scanningQueue[currentQueueElement]);
-		}
+#ifdef A2D_TELEMETRY
+void Measure_Time(unsigned long start, unsigned long *last, unsigned long *maximum)
+{
+	*last = A2D_TIMESTAMP() - start;
+	if(*last > *maximum)
+		*maximum = *last;
+
+	return;
+}
+
+void Sample_Statistics(int channel, unsigned int *samples, int stride, int count)
+{
+	int index = CHANNEL_INDEX(channel);
+	unsigned int sample;
+
+	for(; count > 0; count--, samples += stride)
+	{
+		sample = *samples;
+		if(sample < channelWindow[index].minimum)
+			channelWindow[index].minimum = sample;
+		if(sample > channelWindow[index].maximum)
+			channelWindow[index].maximum = sample;
+		channelWindow[index].sum += sample;
+		channelWindow[index].sumOfSquares += (unsigned long)sample * sample;
+		channelWindow[index].count++;
+	}
 
-		//Remove the current channel from the scanning
-		Remove_From_Scan(scanningQueue[currentQueueElement]);
+	return;
+}
 
-		//Move onto the next channel to be scanned
-		currentQueueElement = Find_Next_Queue_Element(currentQueueElement);
+void Publish_Statistics(int channel)
+{
+	int index = CHANNEL_INDEX(channel);
+	unsigned long now = A2D_TIMESTAMP();
+	struct A2D_Channel_Telemetry *statistics = &channelTelemetry[index];
 
-		//Add the next channel to the scan
-		Add_To_Scan(scanningQueue[currentQueueElement]);
+	//Update period, skipped for the very first value since there is nothing to measure it from
+	if(statistics->completions)
+	{
+		statistics->period = now - channelWindow[index].lastPublished;
+		if((statistics->completions == 1) || (statistics->period < statistics->minimumPeriod))
+			statistics->minimumPeriod = statistics->period;
+		if(statistics->period > statistics->maximumPeriod)
+			statistics->maximumPeriod = statistics->period;
 	}
+	statistics->completions++;
+	channelWindow[index].lastPublished = now;
+
+	//Time from the end of the newest burst in the value until it is published
+	statistics->latency = now - burstTime;
+	if(statistics->latency > statistics->maximumLatency)
+		statistics->maximumLatency = statistics->latency;
+
+	//Raw sample spread over the value, the variance itself is only worked out when asked for
+	statistics->rawMinimum = channelWindow[index].minimum;
+	statistics->rawMaximum = channelWindow[index].maximum;
+	statistics->rawSamples = channelWindow[index].count;
+	rawSum[index] = channelWindow[index].sum;
+	rawSumOfSquares[index] = channelWindow[index].sumOfSquares;
+	Reset_Window(channel);
 
-	//Perform the beginning of scan action if applicable
-	if(*A2D_Channel[scanningQueue[currentQueueElement]].preFunction != NO_PREFUNCTION)
-		A2D_Channel[scanningQueue[currentQueueElement]].preFunction(scanningQueue[currentQueueElement]);
+	return;
+}
+
+void Reset_Window(int channel)
+{
+	int index = CHANNEL_INDEX(channel);
 
-	//(Re)start the Automatic scanning of the Analog ports
-	START_SCAN;
+	channelWindow[index].minimum = ~0;
+	channelWindow[index].maximum = 0;
+	channelWindow[index].sum = 0;
+	channelWindow[index].sumOfSquares = 0;
+	channelWindow[index].count = 0;
 
 	return;
 }
 
-int Find_Next_Queue_Element(int channel)
+int A2D_Channel_Telemetry(int channel, struct A2D_Channel_Telemetry *statistics)
 {
-	int nextChannel = channel;
+	int index;
+	unsigned long long spread;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+	index = CHANNEL_INDEX(channel);
 
-	//Advance to the next valid queue item - Do while used to ensure it runs at least once
-	do
+	*statistics = channelTelemetry[index];
+
+	//Variance = (n*sum(x^2) - sum(x)^2) / n^2, in raw counts squared
+	if(statistics->rawSamples)
 	{
-		++nextChannel;
-		if(nextChannel >= MAX_SCAN_QUEUE_SIZE)
-			nextChannel = 0;
+		spread = (unsigned long long)statistics->rawSamples * rawSumOfSquares[index] - (unsigned long long)rawSum[index] * rawSum[index];
+		statistics->rawVariance = (unsigned long)(spread / ((unsigned long long)statistics->rawSamples * statistics->rawSamples));
 	}
-	while((scanningQueue[nextChannel] == -1) && (nextChannel != channel));//Find the next channel to scan, or we end up back where we started
 
-	return nextChannel;
+	return 1;
 }
 
-void __attribute__((__interrupt__, auto_psv)) _ADC1Interrupt(void)
+void A2D_Telemetry(struct A2D_Telemetry *statistics)
 {
-	//Clear interrupt flag
-	IFS0bits.AD1IF = 0;
+	*statistics = telemetry;
 
-	//Temporarily turn off automatic scanning until we figure out what to do with our current samples
-	STOP_SCAN;
+	return;
+}
 
-	//Perform the end of scan action if applicable
-	if(*A2D_Channel[scanningQueue[currentQueueElement]].postFunction != NO_POSTFUNCTION)
-		A2D_Channel[scanningQueue[currentQueueElement]].postFunction(scanningQueue[currentQueueElement]);
+void A2D_Reset_Telemetry(void)
+{
+	int channel;
+	struct A2D_Channel_Telemetry cleared = {0};
+	struct A2D_Telemetry clearedTelemetry = {0};
 
-	//Let the A2D routine know that we have finished
-	scanIsComplete = 1;
+	telemetry = clearedTelemetry;
+	for(channel = 0; channel < NUMBER_OF_CHANNELS; channel++)
+	{
+		if(!CHANNEL_IN_USE(channel))
+			continue;
+		channelTelemetry[CHANNEL_INDEX(channel)] = cleared;
+		rawSum[CHANNEL_INDEX(channel)] = 0;
+		rawSumOfSquares[CHANNEL_INDEX(channel)] = 0;
+		Reset_Window(channel);
+	}
 
 	return;
 }
+#endif
 
-void A2D_Initialize(void)
+unsigned long Predict_Period(int channel, unsigned long samples)
+{
+	struct A2D_Module *module = CHANNEL_MODULE(channel);
+	A2D_CHANNEL_MASK bit = MASK_BIT(CHANNEL_INPUT(channel));
+	unsigned long samplesPerCycle = 0;
+	int slot;
+	int position;
+	int count;
+
+	//The header formula, (4^b*s*q*t)/(16*r), worked out from the compiled schedule so shared bursts are counted properly
+	for(slot = 0; slot < module->scheduleLength; slot++)
+	{
+		if(!(module->scanSchedule[slot].mask & bit))
+			continue;
+
+		//Same split as Demultiplex(), the channel's share of each interrupt times the interrupts in a burst
+		count = module->scanSchedule[slot].count;
+		for(position = 0; module->scheduleChannels[module->scanSchedule[slot].first + position] != channel; position++)
+			;
+		samplesPerCycle += (unsigned long)(SCAN_BUFFER_SIZE / module->samplesPerInterrupt) * ((module->samplesPerInterrupt - position + count - 1) / count);
+	}
+
+	//Never scanned, it will never update
+	if(samplesPerCycle == 0)
+		return ~0ul;
+
+	//Bursts until enough samples have been collected (rounded up), times the length of a burst on the channel's module
+	return ((samples * module->scheduleLength + samplesPerCycle - 1) / samplesPerCycle) * module->plannedBurstTime;
+}
+
+#ifdef A2D_DEADLINES
+A2D_CHANNEL_MASK Missed_Deadlines(void)
 {
+	A2D_CHANNEL_MASK missed = 0;
 	int channel;
 
-	//Initialize scan queue
-	for(channel = 0; channel < MAX_SCAN_QUEUE_SIZE; ++channel)
-		scanningQueue[channel] = -1;//Unassigned
+	for(channel = 0; channel < NUMBER_OF_CHANNELS; channel++)
+		if(CHANNEL_IN_USE(channel) && (A2D_Channel[CHANNEL_INDEX(channel)].deadline != 0) && (A2D_Predicted_Period(channel) > A2D_Channel[CHANNEL_INDEX(channel)].deadline))
+			missed |= MASK_BIT(channel);
+
+	return missed;
+}
+#endif
+
+unsigned long A2D_Predicted_Period(int channel)
+{
+	int index;
+
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return ~0ul;
+	index = CHANNEL_INDEX(channel);
+
+	//Streaming channels publish every block, everything else (including adaptive channels at full resolution) every average
+	#ifdef A2D_STREAMING
+		if(A2D_Channel[index].streamSegments != (void*)0)
+			return Predict_Period(channel, A2D_Channel[index].samplesPerBlock);
+	#endif
+	return Predict_Period(channel, channelConfig[index].samplesRequired);
+}
 
-	//AD1 Interrupt
-	IFS0bits.AD1IF = 0;				//0 = Interrupt request has not occurred
-	IEC0bits.AD1IE = 1;				//1 = Interrupt request is enabled
+#ifdef A2D_DEADLINES
+int A2D_Channel_Deadline(int channel, unsigned long maximumPeriod)
+{
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
 
-	//A/D Input Scan Select Register (Low)
-	AD1CSSL = 0;					//0 = Analog channel omitted from input scan
+	//With admission control a deadline that is already missed is refused
+	if(admissionControl && (maximumPeriod != 0) && (A2D_Predicted_Period(channel) > maximumPeriod))
+		return 0;
 
-	//A/D Port Configuration Register
-	AD1PCFG = ~0;					//1 = Pin for corresponding analog channel is configured in Digital mode; I/O port read is enabled
+	A2D_Channel[CHANNEL_INDEX(channel)].deadline = maximumPeriod;
 
-	//A/D Input Select Register
-	AD1CHSbits.CH0SA = 0b0111;		//0111 = AVDD
-	AD1CHSbits.CH0NA = 0;			//0 = Channel 0 negative input is VR-
-	AD1CHSbits.CH0SB = 0b0111;		//0111 = AVDD
-	AD1CHSbits.CH0NB = 0;			//0 = Channel 0 negative input is VR-
+	return 1;
+}
 
-	//A/D Control Register 3
-	AD1CON3bits.ADCS = 0b111111;	//111111 = 64 * TCY
-	AD1CON3bits.SAMC = 0b11111;		//11111 = 31 TAD
-	AD1CON3bits.ADRC = 1;			//1 = A/D internal RC clock
+long A2D_Channel_Slack(int channel)
+{
+	unsigned long deadline;
+	unsigned long predicted;
+
+	//No deadline (or no channel) is as much slack as there is
+	if(!CHANNEL_IN_USE(channel) || (A2D_Channel[CHANNEL_INDEX(channel)].deadline == 0))
+		return 0x7FFFFFFFl;
+	deadline = A2D_Channel[CHANNEL_INDEX(channel)].deadline;
+	predicted = A2D_Predicted_Period(channel);
+
+	//Clamp rather than wrap when the channel isn't scanned at all
+	if(predicted > deadline)
+		return ((predicted - deadline) > 0x7FFFFFFFul) ? -0x7FFFFFFFl : -(long)(predicted - deadline);
+	return ((deadline - predicted) > 0x7FFFFFFFul) ? 0x7FFFFFFFl : (long)(deadline - predicted);
+}
 
-	//A/D Control Register 2
-	AD1CON2bits.ALTS = 0;			//0 = Always uses MUX A input multiplexer settings
-	AD1CON2bits.BUFM = 0;			//0 = Buffer is configured as one 16-word buffer (ADC1BUFn<15:0>)
-	AD1CON2bits.SMPI = 0b1111;		//1111 = Interrupts at the completion of conversion for each 16th sample/convert sequence
-	//AD1CON2bits.BUFS is Read Only
-	AD1CON2bits.CSCNA = 1;			//1 = Scan inputs
-	AD1CON2bits.OFFCAL = 0;			//0 = Converts to get the actual input value
-	AD1CON2bits.VCFG = 0;			//0 = Vr+ = AVDD, Vr- = AVSS
+A2D_CHANNEL_MASK A2D_Missed_Deadlines(void)
+{
+	return Missed_Deadlines();
+}
+#endif
 
-	//A/D Control Register 1
-//	AD1CON1bits.DONE is Read Only
-//	AD1CON1bits.SAMP is Read Only
-	AD1CON1bits.ASAM = 0;		//0 = Sampling begins when SAMP bit is set
-	AD1CON1bits.SSRC = 0b111;	//111 = Internal counter ends sampling and starts conversion (auto-convert)
-	AD1CON1bits.FORM = 0;		//0 = Integer (0000 00dd dddd dddd)
-	AD1CON1bits.ADSIDL = 1;		//1 = Discontinue module operation when device enters Idle mode
-	AD1CON1bits.ADON = 1;		//1 = A/D Converter module is operating
+void A2D_Planner_Burst_Time(unsigned long ticks)
+{
+	A2D_Module_Planner_Burst_Time(0, ticks);
 
 	return;
 }
 
-int Add_To_Scan(int pin)
+int A2D_Module_Planner_Burst_Time(int module, unsigned long ticks)
 {
 	//Range checking
-	if(pin >= NUMBER_OF_CHANNELS)
-		return 0;//Failure
+	if(!MODULE_IN_RANGE(module))
+		return 0;
 
-	//Choose the correct pin
-	pin = 1 << pin;
+	modules[module].plannedBurstTime = ticks ? ticks : 1;
 
-	//Turn off the module, changing a CSSL bit with it on can lead to issues
-	AD1CON1bits.ADON = 0;
+	return 1;
+}
 
-	//Set the pin to be scanned
-	AD1CSSL |= pin;
+#ifdef A2D_DEADLINES
+void A2D_Admission_Control(int enable)
+{
+	admissionControl = enable ? 1 : 0;
 
-	//Turn the module back on
-	AD1CON1bits.ADON = 1;
+	return;
+}
+#endif
 
-	return 1;//Success
+int A2D_Schedule_Length(void)
+{
+	return A2D_Module_Schedule_Length(0);
+}
+
+int A2D_Module_Schedule_Length(int module)
+{
+	//Range checking
+	if(!MODULE_IN_RANGE(module))
+		return 0;
+
+	return modules[module].scheduleLength;
+}
+
+A2D_CHANNEL_MASK A2D_Schedule_Mask(int slot)
+{
+	return A2D_Module_Schedule_Mask(0, slot);
+}
+
+A2D_CHANNEL_MASK A2D_Module_Schedule_Mask(int module, int slot)
+{
+	//Range checking
+	if(!MODULE_IN_RANGE(module) || (slot < 0) || (slot >= modules[module].scheduleLength))
+		return 0;
+
+	return modules[module].scanSchedule[slot].mask;
+}
+
+int A2D_Channels_Per_Burst(int channels)
+{
+	return A2D_Module_Channels_Per_Burst(0, channels);
 }
 
-int Remove_From_Scan(int pin)
+int A2D_Module_Channels_Per_Burst(int number, int channels)
 {
+	struct A2D_Module *module;
+	#ifdef A2D_DEADLINES
+		A2D_CHANNEL_MASK missed;
+		char previous;
+	#endif
+
 	//Range checking
-	if(pin >= NUMBER_OF_CHANNELS)
+	if(!MODULE_IN_RANGE(number) || (channels < 1) || (channels > SCAN_BUFFER_SIZE))
 		return 0;//Failure
+	module = &modules[number];
+
+	//Rebuild the schedule around the new burst size
+	#ifdef A2D_DEADLINES
+		missed = Missed_Deadlines();
+		previous = module->channelsPerBurst;
+	#endif
+	module->channelsPerBurst = channels;
+	Compile_Schedule(module);
+
+	//Put it back if it costs a channel its deadline
+	#ifdef A2D_DEADLINES
+		if(admissionControl && (Missed_Deadlines() & ~missed))
+		{
+			module->channelsPerBurst = previous;
+			Compile_Schedule(module);
+			return 0;//Failure
+		}
+	#endif
+
+	return 1;//Success
+}
+
+int A2D_Scan_Mode(enum SCAN_MODE mode)
+{
+	return A2D_Module_Scan_Mode(0, mode);
+}
+
+int A2D_Module_Scan_Mode(int number, enum SCAN_MODE mode)
+{
+	struct A2D_Module *module;
+	volatile unsigned int *control1;
+	volatile unsigned int *control2;
+
+	//Range checking, Timer3 can only trigger AD1
+	if(!MODULE_IN_RANGE(number) || ((mode == SCAN_MODE_TIMED) && (number != 0)))
+		return 0;
+	module = &modules[number];
+	control1 = module->registers->control1;
+	control2 = module->registers->control2;
+
+	//Stop everything while the buffer is reconfigured
+	STOP_SCAN(module);
+	MODULE_OFF(module);
+	CLEAR_INTERRUPT(module);
+
+	switch(mode)
+	{
+		case SCAN_MODE_ON_DEMAND:
+			//BUFM = 0 - Buffer is configured as one 16-word buffer (ADCxBUFn<15:0>)
+			//SMPI = 1111 - Interrupts at the completion of conversion for each 16th sample/convert sequence
+			*control2 = (*control2 & ~(CON2_BUFM | CON2_SMPI)) | SMPI_16;
+			module->samplesPerInterrupt = SCAN_BUFFER_SIZE;
+			break;
+		case SCAN_MODE_CONTINUOUS:
+		case SCAN_MODE_TIMED:
+			//BUFM = 1 - Buffer is configured as two 8-word buffers (ADCxBUFn<15:8> and ADCxBUFn<7:0>)
+			//SMPI = 0111 - Interrupts at the completion of conversion for each 8th sample/convert sequence
+			*control2 = (*control2 & ~(CON2_BUFM | CON2_SMPI)) | CON2_BUFM | SMPI_8;
+			module->samplesPerInterrupt = HALF_BUFFER_SIZE;
+			break;
+		default:
+			MODULE_ON(module);
+			return 0;
+	}
+
+	//Timer3 is only ours while timed, it is left alone otherwise
+	if(mode == SCAN_MODE_TIMED)
+	{
+		*control1 = (*control1 & ~CON1_SSRC) | TIMER3_TRIGGER;	//010 = Timer3 compare ends sampling and starts conversion
+		T3CONbits.TON = 0;				//0 = Stops 16-bit Timer3
+		T3CONbits.TCS = 0;				//0 = Internal clock (FOSC/2)
+		T3CONbits.TGATE = 0;			//0 = Gated time accumulation disabled
+		T3CONbits.TCKPS = 0b00;			//00 = 1:1 prescale value
+		TMR3 = 0;
+		PR3 = samplePeriod - 1;
+		T3CONbits.TON = 1;				//1 = Starts 16-bit Timer3
+	}
+	else
+	{
+		*control1 = (*control1 & ~CON1_SSRC) | AUTO_CONVERT;	//111 = Internal counter ends sampling and starts conversion (auto-convert)
+		if(module->scanMode == SCAN_MODE_TIMED)
+			T3CONbits.TON = 0;			//0 = Stops 16-bit Timer3
+	}
+
+	//Start over with a clean hand-off, the schedule will be restarted by A2D_Routine()
+	module->scanMode = mode;
+	Compile_Schedule(module);
+	STOP_SCAN(module);
+
+	//A2D_Routine() powers it back down if there is still nothing due
+	MODULE_ON(module);
+	module->idle = 0;
+
+	return 1;
+}
+
+void A2D_Initialize(void)
+{
+	struct A2D_Module *module;
+	const struct A2D_Module_Registers *registers;
+	int number;
+	int channel;
+
+	//Initialize scan schedule
+	for(channel = 0; channel < NUMBER_OF_CHANNELS; ++channel)
+		scanWeight[channel] = 0;//Unassigned
+	#ifdef A2D_STATIC_CHANNELS
+		for(channel = 0; channel < CHANNELS_USED; ++channel)
+		{
+			scanWeight[staticSchedule[channel].channel] = staticSchedule[channel].weight;
+			Configure_Streaming(staticSchedule[channel].channel);
+		}
+	#endif
+	samplePeriod = A2D_SAMPLE_PERIOD;
+	#ifdef A2D_DEADLINES
+		admissionControl = 0;
+	#endif
+	#ifdef A2D_GATING
+		gatedChannels = 0;
+		dueChannels = 0;
+		refreshChannels = 0;
+	#endif
+	#ifdef A2D_TELEMETRY
+		A2D_Reset_Telemetry();
+	#endif
+
+	//Every module is set up the same way, through its own registers
+	for(number = 0; number < A2D_NUMBER_OF_MODULES; ++number)
+	{
+		module = &modules[number];
+		registers = &moduleRegisters[number];
+		module->number = number;
+		module->firstChannel = number * A2D_INPUTS_PER_MODULE;
+		module->registers = registers;
+		module->channelsPerBurst = 1;
+		module->samplesPerInterrupt = SCAN_BUFFER_SIZE;
+		module->plannedBurstTime = A2D_BURST_TIME;
+		module->scanMode = SCAN_MODE_ON_DEMAND;
+		module->burstHead = 0;
+		module->burstTail = 0;
+		module->droppedBursts = 0;
+		module->burstHighWaterMark = 0;
+		module->idle = 0;
+		Compile_Schedule(module);
+
+		//ADx Interrupt
+		CLEAR_INTERRUPT(module);		//0 = Interrupt request has not occurred
+		ENABLE_INTERRUPT(module, 1);	//1 = Interrupt request is enabled
+
+		//A/D Input Scan Select Register(s)
+		*registers->scanSelectLow = 0;		//0 = Analog channel omitted from input scan
+		#if A2D_INPUTS_PER_MODULE > 16
+			*registers->scanSelectHigh = 0;	//0 = Analog channel omitted from input scan
+		#endif
+
+		//A/D Port Configuration Register(s)
+		*registers->portConfigLow = ~0;		//1 = Pin for corresponding analog channel is configured in Digital mode; I/O port read is enabled
+		#if A2D_INPUTS_PER_MODULE > 16
+			*registers->portConfigHigh = ~0;	//1 = Pin for corresponding analog channel is configured in Digital mode; I/O port read is enabled
+		#endif
+
+		//A/D Input Select Register
+		//CH0NB<15> = 0 - Channel 0 negative input is VR-
+		//CH0SB<12:8> = 0111 - AVDD
+		//CH0NA<7> = 0 - Channel 0 negative input is VR-
+		//CH0SA<4:0> = 0111 - AVDD
+		*registers->inputSelect = 0x0707;
+
+		//A/D Control Register 3
+		//ADRC<15> = 1 - A/D internal RC clock
+		//SAMC<12:8> = 11111 - 31 TAD
+		//ADCS<7:0> = 111111 - 64 * TCY
+		*registers->control3 = 0x9F3F;
+
+		//A/D Control Register 2
+		//VCFG<15:13> = 0 - Vr+ = AVDD, Vr- = AVSS
+		//OFFCAL<12> = 0 - Converts to get the actual input value
+		//CSCNA<10> = 1 - Scan inputs
+		//BUFS<7> is Read Only
+		//SMPI<5:2> = 1111 - Interrupts at the completion of conversion for each 16th sample/convert sequence
+		//BUFM<1> = 0 - Buffer is configured as one 16-word buffer (ADCxBUFn<15:0>)
+		//ALTS<0> = 0 - Always uses MUX A input multiplexer settings
+		*registers->control2 = CON2_CSCNA | SMPI_16;
+
+		//A/D Control Register 1
+		//ADSIDL<13> = 1 - Discontinue module operation when device enters Idle mode
+		//FORM<9:8> = 0 - Integer (0000 00dd dddd dddd)
+		//SSRC<7:5> = 111 - Internal counter ends sampling and starts conversion (auto-convert)
+		//ASAM<2> = 0 - Sampling begins when SAMP bit is set
+		//SAMP<1> and DONE<0> are Read Only
+		*registers->control1 = CON1_ADSIDL | AUTO_CONVERT;
+		MODULE_ON(module);				//1 = A/D Converter module is operating
+	}
+
+	#ifdef A2D_STATIC_CHANNELS
+		for(channel = 0; channel < CHANNELS_USED; ++channel)
+			Change_To_Analog(staticSchedule[channel].channel);
+	#endif
+	#ifdef A2D_STATIC_DEADLINES
+		#define A2D_DEADLINE(channel, maximumPeriod)	A2D_Channel_Deadline(channel, maximumPeriod);
+		A2D_STATIC_DEADLINES
+		#undef A2D_DEADLINE
+	#endif
 
-	//Choose the correct pin
-	pin = 1 << pin;
+	return;
+}
+
+int Set_Scan_Mask(struct A2D_Module *module, A2D_CHANNEL_MASK mask)
+{
+	A2D_CHANNEL_MASK current = *module->registers->scanSelectLow;
+
+	//A running module already scanning these pins is left alone, the ADON cycle is only needed when CSSL changes
+	#if A2D_INPUTS_PER_MODULE > 16
+		current |= (A2D_CHANNEL_MASK)*module->registers->scanSelectHigh << 16;
+	#endif
+	if((current == mask) && (*module->registers->control1 & CON1_ADON))
+		return 1;//Success
 
 	//Turn off the module, changing a CSSL bit with it on can lead to issues
-	AD1CON1bits.ADON = 0;
+	MODULE_OFF(module);
 
-	//Remove the pin from being scanned
-	AD1CSSL &= ~pin;
+	//Select every pin in the burst at once
+	*module->registers->scanSelectLow = (unsigned int)mask;
+	#if A2D_INPUTS_PER_MODULE > 16
+		*module->registers->scanSelectHigh = (unsigned int)(mask >> 16);
+	#endif
 
 	//Turn the module back on
-	AD1CON1bits.ADON = 1;
+	MODULE_ON(module);
 
 	return 1;//Success
 }
 
 int Change_To_Analog(int pin)
 {
+	const struct A2D_Module_Registers *registers;
+
 	//Range checking
-	if(pin >= NUMBER_OF_CHANNELS)
+	if((pin < 0) || (pin >= NUMBER_OF_CHANNELS))
 		return 0;//Failure
 
-	//Choose the correct pin
-	pin = 1 << pin;
+	//Choose the correct module and pin
+	registers = &moduleRegisters[pin / A2D_INPUTS_PER_MODULE];
+	pin = CHANNEL_INPUT(pin);
 
-	//Set the pin(s) to digital
-	AD1PCFG &= ~pin;
+	//Set the pin to analog, inputs 16 and up are in the high register
+	#if A2D_INPUTS_PER_MODULE > 16
+		if(pin >= 16)
+		{
+			*registers->portConfigHigh &= ~(1u << (pin - 16));
+			return 1;//Success
+		}
+	#endif
+	*registers->portConfigLow &= ~(1u << pin);
 
 	return 1;//Success
 }
 
 int Change_To_Digital(int pin)
 {
+	const struct A2D_Module_Registers *registers;
+
 	//Range checking
-	if(pin >= NUMBER_OF_CHANNELS)
+	if((pin < 0) || (pin >= NUMBER_OF_CHANNELS))
 		return 0;//Failure
 
-	//Choose the correct pin
-	pin = 1 << pin;
+	//Choose the correct module and pin
+	registers = &moduleRegisters[pin / A2D_INPUTS_PER_MODULE];
+	pin = CHANNEL_INPUT(pin);
 
-	//Set the pin(s) to digital
-	AD1PCFG |= pin;
+	//Set the pin to digital, inputs 16 and up are in the high register
+	#if A2D_INPUTS_PER_MODULE > 16
+		if(pin >= 16)
+		{
+			*registers->portConfigHigh |= 1u << (pin - 16);
+			return 1;//Success
+		}
+	#endif
+	*registers->portConfigLow |= 1u << pin;
 
 	return 1;//Success
 }
 
 int A2D_Add_To_Scan_Queue(int channel)
 {
-	int position = 0;
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+
+	//Each extra call is one more scan per cycle
+	return A2D_Scan_Weight(channel, scanWeight[channel] + 1);
+}
+
+int A2D_Scan_Weight(int channel, int weight)
+{
+	struct A2D_Module *module;
+	int totalWeight = 0;
+	int scan;
+	#ifdef A2D_DEADLINES
+		A2D_CHANNEL_MASK missed;
+		unsigned char previous;
+	#endif
 
 	//Check if we are within a valid range of channels
-	if((channel < 0) || (channel >= NUMBER_OF_CHANNELS))
+	if(!CHANNEL_IN_USE(channel) || (weight < 0))
 		return 0;
+	module = CHANNEL_MODULE(channel);
 
-	//Find the next free scan position
-    while((scanningQueue[position] != -1) && (position < MAX_SCAN_QUEUE_SIZE))
-        position++;
+	//Find out if there is room in the schedule of the channel's module
+	for(scan = module->firstChannel; scan < module->firstChannel + A2D_INPUTS_PER_MODULE; scan++)
+		if(scan != channel)
+			totalWeight += scanWeight[scan];
+	if((totalWeight + weight) > SCHEDULE_SIZE)
+		return 0;
 
 	//Make it so
-	if(position < MAX_SCAN_QUEUE_SIZE)
-		scanningQueue[position] = channel;//Make it official
-	else
-		return 0;
+	#ifdef A2D_DEADLINES
+		missed = Missed_Deadlines();
+		previous = scanWeight[channel];
+	#endif
+	scanWeight[channel] = weight;
+	Compile_Schedule(module);
+
+	//Every other channel gets a smaller share of the schedule, put it back if that costs any of them their deadline
+	#ifdef A2D_DEADLINES
+		if(admissionControl && (Missed_Deadlines() & ~missed))
+		{
+			scanWeight[channel] = previous;
+			Compile_Schedule(module);
+			return 0;
+		}
+	#endif
 
 	//So much win!
 	return 1;
 }
 
+#ifndef A2D_STATIC_CHANNELS
 int A2D_Channel_Settings(int channel, enum RESOLUTION desiredResolutionIncrease, int numberOfAverages, int (*formatPointer)(int), void (*preFunction)(int), void (*postFunction)(int), void (*finishedFunction)(int))
 {
+	int index = CHANNEL_INDEX(channel);
 	unsigned long samplesRequired;
 
 	//Check if we are within a valid range of channels
-	if((channel < 0) || (channel >= NUMBER_OF_CHANNELS))
+	if(!CHANNEL_IN_USE(channel))
 		return 0;
 
-	//Determine the number of samples required
-	samplesRequired = numberOfAverages;
-	switch(desiredResolutionIncrease)
-	{
-		case RESOLUTION_10_BIT:
-			samplesRequired *= 1;//4^0
-			break;
-		case RESOLUTION_11_BIT:
-			samplesRequired *= 4;//4^1
-			break;
-		case RESOLUTION_12_BIT:
-			samplesRequired *= 16;//4^2
-			break;
-		case RESOLUTION_13_BIT:
-			samplesRequired *= 64;//4^3
-			break;
-		case RESOLUTION_14_BIT:
-			samplesRequired *= 256;//4^4
-			break;
-		case RESOLUTION_15_BIT:
-			samplesRequired *= 1024;//4^5
-			break;
-		case RESOLUTION_16_BIT:
-			samplesRequired *= 4096;//4^6
-			break;
-		default:
-			return 0;
-	}
+	//Determine the number of samples required (4^b samples per averaged reading)
+	if((desiredResolutionIncrease < RESOLUTION_10_BIT) || (desiredResolutionIncrease > RESOLUTION_16_BIT) || (numberOfAverages < 1))
+		return 0;
+	samplesRequired = (unsigned long)numberOfAverages << (2 * desiredResolutionIncrease);
 
 	//Check if we have a valid number of averages (Minimum of 16 and must be a multiple of 16 that is no higher than a 16 bit number)
 	if(((samplesRequired % 16) != 0) || (samplesRequired < 16) || (samplesRequired >= 65536))
 		return 0;
 
+	//With admission control the new average has to fit in the channel's deadline with the current schedule
+	#ifdef A2D_DEADLINES
+		if(admissionControl && (A2D_Channel[index].deadline != 0) && (Predict_Period(channel, samplesRequired) > A2D_Channel[index].deadline))
+			return 0;
+	#endif
+
 	//Set values
-	A2D_Channel[channel].value = 0;
-	A2D_Channel[channel].sumOfSamples = 0;
-	A2D_Channel[channel].bitsOfResolutionIncrease = desiredResolutionIncrease;
-	A2D_Channel[channel].samplesRequired = (int)samplesRequired;
-	A2D_Channel[channel].samplesTaken = 0;
-	A2D_Channel[channel].formatPointer = formatPointer;
-	A2D_Channel[channel].preFunction = preFunction;
-	A2D_Channel[channel].postFunction = postFunction;
-	A2D_Channel[channel].finishedFunction = finishedFunction;
+	A2D_Channel[index].value = 0;
+	#ifdef A2D_LAZY_FORMATTING
+		A2D_Channel[index].formatPending = 0;
+	#endif
+	#ifdef A2D_ADAPTIVE
+		A2D_Channel[index].adaptiveMaximumStep = 0;
+		A2D_Channel[index].adaptiveStep = 0;
+	#endif
+	#ifdef A2D_CALIBRATION
+		A2D_Channel[index].calibrated = 0;
+	#endif
+	A2D_Channel[index].sumOfSamples = 0;
+	channelConfig[index].bitsOfResolutionIncrease = desiredResolutionIncrease;
+	channelConfig[index].samplesRequired = (int)samplesRequired;
+	A2D_Channel[index].samplesTaken = 0;
+	channelConfig[index].formatPointer = formatPointer;
+	channelConfig[index].preFunction = preFunction;
+	channelConfig[index].postFunction = postFunction;
+	channelConfig[index].finishedFunction = finishedFunction;
 	
-	//Calculate the DSP and averaging number
-	A2D_Channel[channel].valueForDSP = numberOfAverages;
-	switch(desiredResolutionIncrease)
-	{
-		case RESOLUTION_10_BIT:
-			break;
-		case RESOLUTION_11_BIT:
-			A2D_Channel[channel].valueForDSP *= 2;//2^1;
-			break;
-		case RESOLUTION_12_BIT:
-			A2D_Channel[channel].valueForDSP *= 4;//2^2;
-			break;
-		case RESOLUTION_13_BIT:
-			A2D_Channel[channel].valueForDSP *= 8;//2^3;
-			break;
-		case RESOLUTION_14_BIT:
-			A2D_Channel[channel].valueForDSP *= 16;//2^4;
-			break;
-		case RESOLUTION_15_BIT:
-			A2D_Channel[channel].valueForDSP *= 32;//2^5;
-			break;
-		case RESOLUTION_16_BIT:
-			A2D_Channel[channel].valueForDSP *= 64;//2^6;
-			break;
-	}
+	channelConfig[index].numberOfAverages = numberOfAverages;
+
+	//Resolve the DSP and averaging divisor into shifts/multiplies now, rather than dividing on every completion
+	Configure_Decimation(channel);
+	Configure_Rounding(channel);
+	Configure_Streaming(channel);
 
 	Change_To_Analog(channel);
 
 	//Success!
 	return 1;
 }
+#endif
+
+int A2D_Read_Channels(A2D_CHANNEL_MASK channelMask, int *values, unsigned int *sequences, A2D_CHANNEL_MASK *changed)
+{
+	unsigned int start;
+	A2D_CHANNEL_MASK updated = 0;
+	int channel;
+	int index;
+
+	//Values are part way through being published, reading now could mix old and new values
+	start = publishSequence;
+	if(start & 1)
+		return 0;
+
+	for(channel = 0; channel < NUMBER_OF_CHANNELS; channel++)
+	{
+		if(!(channelMask & MASK_BIT(channel)) || !CHANNEL_IN_USE(channel))
+			continue;
+		index = CHANNEL_INDEX(channel);
+
+		//Skip channels that haven't changed since the caller last read them
+		if((sequences != (void*)0) && (sequences[channel] == A2D_Channel[index].sequence))
+			continue;
+
+		values[channel] = A2D_Value(channel);
+		if(sequences != (void*)0)
+			sequences[channel] = A2D_Channel[index].sequence;
+		updated |= MASK_BIT(channel);
+	}
+
+	if(changed != (void*)0)
+		*changed = updated;
+
+	//If anything was published while we were reading then the set may be mixed
+	return publishSequence == start;
+}
+
+unsigned int A2D_Sequence(int channel)
+{
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+
+	return A2D_Channel[CHANNEL_INDEX(channel)].sequence;
+}
+
+#ifdef A2D_LAZY_FORMATTING
+int A2D_Channel_Lazy_Formatting(int channel, int lazy)
+{
+	//Check if we are within a valid range of channels
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+
+	//Catch up on any formatting still owed before switching
+	A2D_Value(channel);
+	A2D_Channel[CHANNEL_INDEX(channel)].lazyFormatting = lazy ? 1 : 0;
+
+	return 1;
+}
+#endif
 
 int A2D_Value(int channel)
 {
-	return A2D_Channel[channel].value; //Return the value - NOTE: it has already been formatted
+	int index;
+
+	//Check if we are within a valid range of channels (static channels only have storage if they are in the table)
+	if(!CHANNEL_IN_USE(channel))
+		return 0;
+	index = CHANNEL_INDEX(channel);
+
+	//Lazy channels are formatted on the first read after a new value, every read after that is just the cached value
+	#ifdef A2D_LAZY_FORMATTING
+		if(A2D_Channel[index].formatPending)
+		{
+			A2D_Channel[index].value = channelConfig[index].formatPointer(A2D_Channel[index].rawValue);
+			A2D_Channel[index].formatPending = 0;
+		}
+	#endif
+
+	return A2D_Channel[index].value; //Return the value - NOTE: it has already been formatted
 }
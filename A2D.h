@@ -5,18 +5,173 @@ to config.c. The analog pin definitions (A2D_PIN_DEFINITIONS) that are placed in
 on the analog channel (eg AN5 needs to be enumerated to 5).
 
 The initiliaze routine needs to be run once on startup. After that the you are required to run both A2D_Channel_Settings() and
-A2D_Add_To_Scan_Queue() before the A2D will work. Calling the A2D_Add_To_Scan_Queue() function several times adds multiple
-instances of the channel to the queue. This is a way to get a quicker update rate on a channel if there are several other
-channels. Running A2D_Channel_Settings() once a conversion is under way will reset the channel to the specified new settings and
+A2D_Add_To_Scan_Queue() (or A2D_Scan_Weight()) before the A2D will work. Calling the A2D_Add_To_Scan_Queue() function several
+times raises the channel's weight by one each time, A2D_Scan_Weight() sets it directly. A channel with a weight of w is scanned w
+times per schedule cycle, which is a way to get a quicker update rate on a channel if there are several other channels. The
+weights are compiled into a schedule where the repeats are spread evenly through the cycle (not clumped together), with up to 64
+scans per cycle in total. Running A2D_Channel_Settings() once a conversion is under way will reset the channel to the specified new settings and
 restart the conversion process. It would typically only be called multiple times if a different resolution was temporarily
 required, or if the format/pre/post/finished functions needed to be changed for use in different configurations.
 
 Reading the current value is done through A2D_Value(). Note: This value is not the raw A2D value, rather it is already formatted
 and at the correct resolution as specificied according to the latest calling of A2D_Channel_Settings();
 
+Normally the format function runs on every new value. A2D_Channel_Lazy_Formatting() leaves the formatting until the value is
+read instead: A2D_Value() formats the newest value the first time it is read and keeps the result, so repeated reads are free
+and a channel that is never read never calls its format function. A finished function that reads the value through A2D_Value()
+still sees it formatted, it just pays for the formatting at that point. Lazy formatting is off by default, and only compiled
+in when A2D_LAZY_FORMATTING is defined in the config file.
+
+A2D_Channel_Adaptive() lets a channel trade resolution for update rate on its own. The average of the channel's samples in each
+burst is compared with the one before it, and a jump bigger than the threshold (in raw counts) drops the channel straight to
+the minimum resolution, giving up a bit of resolution is a quarter of the samples so values arrive 4x sooner per bit. Each
+block that finishes without a transient steps the resolution back up by one bit, until it is back to the resolution set by
+A2D_Channel_Settings(). Values are always published at the full resolution scale (the coarse values just have zeros in the
+bottom bits), so the format function and event rules don't need to know. A2D_Channel_Resolution() shows the current step.
+Adaptive channels can't also be streaming, and calling A2D_Channel_Settings() turns the adaptive mode off. Only compiled in
+when A2D_ADAPTIVE is defined in the config file.
+
+A2D_Channel_Filter() puts a spike filter in front of the averaging. The raw samples a channel gets from each burst are filtered
+before they are summed, so a single outlier (eg a relay switching) doesn't get averaged into a value made of thousands of
+samples. FILTER_MEDIAN replaces every sample with the median of the 3 or 5 samples around it, FILTER_TRIMMED_MEAN drops the
+highest and lowest samples of the burst and FILTER_SIGMA drops samples further than k standard deviations from the mean of the
+burst. The samples dropped are replaced by the mean of the ones kept, so the burst still has the same number of samples and
+the resolution, averages and update rate are unchanged. The sorting is done with fixed sorting networks so the time taken
+doesn't depend on the samples. The filters only see one burst at a time, so with several channels per burst there are fewer
+samples to work with, and the sigma is worked out from the burst itself: a lone spike among n samples can be at most
+(n - 1)/sqrt(n) sigma out (3.75 with 16 samples, 2.47 with 8), so k needs to be below that. Telemetry and adaptive oversampling
+see the filtered samples. Filters are off by default, and only compiled in when A2D_FILTERS is defined in the config file.
+
+A2D_Channel_Calibration() saves writing a format function just to calibrate or linearize a channel. Each value is corrected
+by an offset (in counts) and then a fixed point gain (A2D_UNITY_GAIN = 1.0, up to almost 16x) and stays within the range of the
+channel. An optional table then maps the corrected counts onto whatever units suit (eg a thermistor in tenths of a degree):
+it holds segments + 1 outputs for evenly spaced inputs from 0 to the full scale of the channel (2^(10 + resolution increase)),
+and values in between are interpolated. With the segments a power of two (2 to 256) looking up and interpolating is a shift
+and a multiply, no search and no division. The calibrated value is what gets published, the format function (if there is one)
+is given the calibrated value, while event rules keep working in counts. A2D_Calibrate() puts a whole array of values through
+the calibration of a channel at once, in loops a host compiler can vectorize, for calibrating recorded or replayed data in
+bulk, and A2D_Calibrate_Channels() does the same for records holding one value of each of several channels. Calling
+A2D_Channel_Settings() turns calibration off, as the table depends on the resolution. Only compiled in when A2D_CALIBRATION is
+defined in the config file.
+
+A2D_Channel_Event() stops the finished function being called for every value. The rule is checked as each value is
+published and the finished function is only called when it fires: crossing above or below a threshold, entering or leaving a
+window, or moving more than a set number of counts from the last value reported. The threshold rules fire once and then re-arm
+when the value comes back past the hysteresis, so a noisy value sitting on the threshold doesn't keep calling the function. The
+limits are in counts at the resolution of the channel, before the format function. Values are still published (A2D_Value() and
+the sequence counter) whether or not the rule fires. Only compiled in when A2D_EVENTS is defined in the config file, without
+it the finished function is called for every value.
+
+Every channel has a sequence counter (A2D_Sequence()) that goes up each time a new value is published. A2D_Read_Channels()
+reads several channels in one pass and, given the sequence numbers from the last read, only copies the channels that have
+changed since then. A2D_Routine() publishes all of the values from the bursts waiting for it before calling any of the finished
+functions, so a snapshot taken from the main loop (or a finished function) is always consistent. When reading from an interrupt
+that may have interrupted A2D_Routine(), a return of 0 means values were being published and the read should be retried later.
+
 A2D_Routine() needs to be called on a regular basis. The more often it is called, the faster channels will update their values.
 Calling the routine before a conversion is done will not interrupt the current conversion, though it will have no other effect.
 
+By default a burst is only started from A2D_Routine() (SCAN_MODE_ON_DEMAND). Calling A2D_Scan_Mode(SCAN_MODE_CONTINUOUS) splits
+the buffer in two so the module keeps sampling into one half while the ISR copies the other, and the ISR moves onto the next
+channel itself. The converter no longer waits on the main loop between bursts.
+Note: in continuous (and timed) mode the pre/post functions are called from the ISR.
+
+In both modes the ISR copies each finished burst into a ring (A2D_BURST_RING_SIZE bursts deep, 4 by default) and A2D_Routine()
+processes every burst waiting in it. If the routine falls so far behind that the ring is full, new bursts are dropped (the
+converter is never held up). A2D_Dropped_Bursts() and A2D_Burst_High_Water_Mark() show how close the ring has come to filling,
+use them to size A2D_BURST_RING_SIZE for the main loop timing.
+
+A2D_Scan_Mode(SCAN_MODE_TIMED) works like continuous mode except that the module waits for Timer3 to start each conversion, so
+samples are taken at a fixed rate (A2D_Sample_Period(), in instruction cycles) no matter how busy the main loop is. That is what
+the averaging assumes, and it turns the average into a proper low-pass filter. The library takes over Timer3 (1:1 prescale)
+while timed, and stops it when another mode is selected. The period has to be longer than a single conversion. Whenever
+A2D_TIMESTAMP() is defined the ISR also measures the time between bursts, A2D_Burst_Jitter() reports the spread (in any mode,
+so the wander of on-demand scanning can be seen as well).
+
+Channels that are only needed now and then can be gated (A2D_Channel_Gating()), so they stop being scanned until someone asks
+for a value. A2D_Request() asks for one: the channel starts a fresh average, is scanned until the value is published (the
+sequence counter goes up and the finished function is called as usual) and then drops out again. Bursts where none of the
+channels are due are skipped, and when nothing on a module is due the converter is switched off (ADON = 0, and Timer3 when
+timed) so there are no interrupts at all. A2D_Routine() switches it back on as soon as something is requested. With
+A2D_TIMESTAMP() defined A2D_Channel_Refresh_Interval() requests a new value automatically, a set number of ticks after the
+last request, for channels that only need refreshing every so often. Channels that aren't gated are scanned all the time as
+before, a gated channel that shares a burst with one of them just has its samples thrown away while it isn't due. A module
+with nothing scheduled on it at all is switched off the same way. A2D_Idle() says when every module is off, eg before putting
+the processor to sleep. The planner and deadlines don't know about gating, they assume every channel is being scanned (the
+longest the periods can be). Gating is only compiled in when A2D_GATING is defined in the config file, A2D_Idle() is always there.
+
+A2D_Channels_Per_Burst() lets a single burst scan several channels. Consecutive schedule entries (without repeats) are grouped
+into one CSSL mask, the module samples them in ascending order and the buffer is split between them, so each of n channels gets
+16/n samples per burst instead of a whole burst to itself. In continuous (and timed) mode a burst is limited to 8 channels (one half).
+
+Parts with more than 16 analog inputs are covered by A2D_INPUTS_PER_MODULE (up to 32, inputs 16 and up are scanned through
+ADxCSSH and configured through ADxPCFGH), and parts with a second converter by A2D_NUMBER_OF_MODULES = 2. Every module has its
+own registers, schedule, burst ring and interrupt (_ADC1Interrupt()/_ADC2Interrupt()) and scans at the same time as the other,
+A2D_Routine() serves all of them. Channels are numbered across the modules: channel = module * A2D_INPUTS_PER_MODULE + input,
+so with 16 inputs each AN3 of AD2 is channel 19. A channel only ever belongs to one module, and the weights of the channels on a
+module share that module's schedule (up to 64 scans per cycle each). The functions that act on a whole module (scan mode,
+channels per burst, burst counters, jitter, planner burst time and schedule) work on AD1, as they always have, and each has an
+A2D_Module_...() version that takes the module number (0 = AD1, 1 = AD2). Timed scanning is only available on AD1 (Timer3). With
+more than 16 channels in total the channel masks (A2D_CHANNEL_MASK) are 32 bits wide. The register names used for the extra
+inputs and the second module are the ones from the PIC24F/dsPIC33F device headers (AD1PCFGL/H, AD1CSSH, ADC2BUF0, AD2CON1,
+AD2CHS, AD2CSSL, AD2PCFGL, IFS1bits.AD2IF...), a part that names them differently can #define the names in config.h.
+
+The library can also be run on a Linux host against a simulated AD1 module (and AD2). Include A2D_Sim.h from the host config.h in place
+of the device header and add A2D_Sim.c to the build, see A2D_Sim.h for details. A2D_Bench.c is built the same way, it times
+A2D_Routine(), the ISR, A2D_Scan_Weight() and A2D_Channel_Settings(), tabulates the update rate against the number of channels
+and the resolution, and cross-checks each stage of the pipeline (see its header), run it before and after a change.
+
+A channel normally publishes a value once every samplesRequired samples. Giving it a ring of segments with
+A2D_Channel_Streaming() turns it into a moving average: the average is split into equal blocks, and every time a block finishes
+it replaces the oldest block in the window and a new value is published. The resolution and the averaging window are unchanged,
+but values are refreshed once per block. With 16 segments (and a single channel per burst) an average of up to 256 samples is
+refreshed after every burst. Only compiled in when A2D_STREAMING is defined in the config file.
+
+A2D_Channel_Capture() keeps the recent history of a channel for debugging, either its raw samples (before any spike filter) or
+its values (after decimation, before calibration and formatting), in a ring supplied by the caller. The ring records all the
+time and is frozen a set number of entries after the trigger, like an oscilloscope, so it holds what led up to the trigger
+as well as what followed. The trigger is either A2D_Capture_Trigger() or an entry outside the below/above limits (0 and 0xFFFF
+never trigger). Recording is done by A2D_Routine() as the bursts are processed, the ISR isn't involved, so it costs nothing
+in interrupt latency. A2D_Capture_Read() hands back the ring as it is, oldest entry first, as two pieces (the second one is
+empty until the ring has wrapped) without copying anything. Once it returns 1 the capture is frozen and the pieces won't change
+until A2D_Channel_Capture() is called again to re-arm it. Only compiled in when A2D_CAPTURE is defined in the config file.
+
+Defining A2D_TELEMETRY (and A2D_TIMESTAMP()) in the config file turns on A2D_Channel_Telemetry(), A2D_Telemetry() and
+A2D_Reset_Telemetry(). Per channel they report how many values have been published, the period between them, the latency from
+the last burst to the published value, bursts lost to overruns and the raw sample min/max/variance behind the latest value.
+Globally they report the time spent in the ISR and in A2D_Routine(). All times are in A2D_TIMESTAMP() ticks. Without
+A2D_TELEMETRY none of it is compiled in. On a host build A2D_SIM_TIMESTAMP() can be used as the tick count.
+
+If the channels never change after startup they can be listed in the config file instead (A2D_STATIC_CHANNELS), one
+A2D_CHANNEL(channel, resolution, averages, format, pre, post, finished, weight) per channel with the same meaning as the arguments
+of A2D_Channel_Settings() and A2D_Scan_Weight(). The table is compiled into program memory with the decimation factors already
+worked out, only the channels listed get any RAM, and an invalid entry fails to compile. A2D_Initialize() sets everything up so
+A2D_Channel_Settings() is not needed (and is not available), the rest of the functions work as usual but only on the channels in
+the table. The schedule is only made big enough for the weights in the table (those of the busier module), A2D_Scan_Weight()
+can move weight between channels but can't add to the total. Any format/pre/post/finished functions named in the table need to
+be declared in config.h.
+
+Each channel can be given a deadline, the longest acceptable time between values (A2D_Channel_Deadline()). The library works
+out the update period every channel should get from the compiled schedule (A2D_Predicted_Period(), the formula below but
+counting shared bursts properly) and how much room it has to spare (A2D_Channel_Slack(), negative = deadline missed).
+A2D_Missed_Deadlines() lists the channels that currently can't make it. Times are in ticks of whatever unit is passed to
+A2D_Planner_Burst_Time(), the time a single burst takes: the main loop time in on-demand mode, or 16 conversions in continuous
+mode. A2D_Admission_Control(1) turns the warnings into rules: A2D_Scan_Weight(), A2D_Add_To_Scan_Queue(),
+A2D_Channels_Per_Burst(), A2D_Channel_Settings() and A2D_Channel_Deadline() refuse (return 0 and change nothing) anything that
+would make a channel miss a deadline it was meeting. Deadlines can also be listed in the config file (A2D_STATIC_DEADLINES).
+Deadlines, the slack and admission control are only compiled in when A2D_DEADLINES is defined in the config file, the predicted
+periods are always there.
+
+A2D_Process_Burst() hands a channel raw samples that didn't come from the converter (eg a recorded trace), they go through the
+same accumulation, decimation, formatting and event rules as a burst would, and the finished functions are called. It is meant
+for host builds, a channel that is also being scanned would mix the two. A2D_Replay.c is a host program built on it, it streams
+a binary or CSV capture through the configured channels and writes out every value published, for regression testing the DSP
+against recorded data and for measuring its throughput.
+
+A2D_Planner.c is a host program that is built with the project's config.h (against A2D_Sim.c, as above), sets up the
+A2D_STATIC_CHANNELS table and prints the schedule, the predicted periods and the deadlines, so a system can be sized before
+it is flashed.
+
 The markup above each function will pop-up as a helpful reminder of the arguments each function will take, as well as what value
 is returned, and what the function will do.
 
@@ -25,10 +180,10 @@ Calculating how much time an full update will take to complete is done via the f
  * Where:
  * b = Bits of resolution increase from 10-bit (0 for 10 bit, 1 for 11 bit, etc)
  * s = Number of samples at the requested resolution for an updated value
- * q = Number of channels in the queue (NOTE: Includes repeated channels)
+ * q = Sum of all the channel weights (NOTE: Includes repeated channels)
  * t = The time interval between calling the A2D_Routine (Eg. Time of main loop)
  * 16 = Constant, it represents the number of samples per scan
- * r = Number of times a channel appears in the queue (Can be more than once for repeated channels)
+ * r = The weight of the channel (Can be more than one for repeated channels)
 */
 
 #ifndef A2D_H
@@ -54,12 +209,34 @@ enum A2D_PIN_DEFINITIONS
 	A2D_A13 = 13,	//A13
 	A2D_A14 = 14,	//A14
 	A2D_A15 = 15,	//A15
+	//A2D_A16 = 16 and up with more inputs per module or a second module (AD2 AN0 = A2D_INPUTS_PER_MODULE)
 };
 
 //A2D Library
-#define A2D_MAJOR	1
+#define A2D_MAJOR	2
 #define A2D_MINOR	0
 #define A2D_PATCH	0
+//#define A2D_INPUTS_PER_MODULE	32	//Optional - Analog inputs per module, more than 16 uses ADxCSSH/ADxPCFGH (default 16)
+//#define A2D_NUMBER_OF_MODULES	2	//Optional - 2 = AD1 and AD2 both scan, see the notes at the top of A2D.h (default 1)
+//#define A2D_BURST_RING_SIZE	8	//Optional - Bursts that can wait between the ISR and A2D_Routine() (power of 2, default 4)
+//#define A2D_TELEMETRY				//Optional - Turns on the telemetry functions, requires A2D_TIMESTAMP()
+//#define A2D_TIMESTAMP()	TMR1	//Optional - A free running tick count (eg a timer register), used by the telemetry
+//#define A2D_EVENTS				//Optional - Turns on the event rules (A2D_Channel_Event())
+//#define A2D_ADAPTIVE				//Optional - Turns on adaptive oversampling (A2D_Channel_Adaptive())
+//#define A2D_CALIBRATION			//Optional - Turns on calibration (A2D_Channel_Calibration(), A2D_Calibrate...())
+//#define A2D_CAPTURE				//Optional - Turns on waveform capture (A2D_Channel_Capture(), A2D_Capture_...())
+//#define A2D_STREAMING				//Optional - Turns on streaming channels (A2D_Channel_Streaming())
+//#define A2D_LAZY_FORMATTING		//Optional - Turns on lazy formatting (A2D_Channel_Lazy_Formatting())
+//#define A2D_DEADLINES				//Optional - Turns on deadlines and admission control (A2D_Channel_Deadline(), A2D_Admission_Control())
+//#define A2D_FILTERS				//Optional - Turns on the spike filters (A2D_Channel_Filter())
+//#define A2D_GATING				//Optional - Turns on demand gating (A2D_Channel_Gating(), A2D_Request(), A2D_Channel_Refresh_Interval())
+//#define A2D_SAMPLE_PERIOD	1600	//Optional - Instruction cycles between samples in SCAN_MODE_TIMED (default 1600)
+//#define A2D_RC_TAD_CYCLES	4		//Optional - A/D internal RC clock period in instruction cycles, used to check A2D_Sample_Period() (default 4)
+//#define A2D_BURST_TIME	1280		//Optional - Ticks per burst for the planner (default 1, ie periods are counted in bursts)
+//#define A2D_STATIC_DEADLINES	A2D_DEADLINE(A2D_A0, 50000)	//Optional - Deadlines set by A2D_Initialize(), requires A2D_DEADLINES
+//#define A2D_STATIC_CHANNELS	\	//Optional - Fixed channel table, see the notes at the top of A2D.h
+//	A2D_CHANNEL(A2D_A0, RESOLUTION_12_BIT, 16, NO_FORMATING, NO_PREFUNCTION, NO_POSTFUNCTION, NO_FINISHED_FUNCTION, 1)	\
+//	A2D_CHANNEL(A2D_A5, RESOLUTION_10_BIT, 64, NO_FORMATING, NO_PREFUNCTION, NO_POSTFUNCTION, NO_FINISHED_FUNCTION, 2)
 */
 
 /***************Add to config file***************/
@@ -77,6 +254,21 @@ enum A2D_PIN_DEFINITIONS
 #define NO_PREFUNCTION			(void*)0
 #define NO_POSTFUNCTION			(void*)0
 #define NO_FINISHED_FUNCTION	(void*)0
+#define A2D_UNITY_GAIN			4096	//Calibration gain of 1.0, gains are in 1/4096ths
+#ifndef A2D_NUMBER_OF_MODULES
+	#define A2D_NUMBER_OF_MODULES	1	//AD1 only unless config.h says otherwise
+#endif
+#ifndef A2D_INPUTS_PER_MODULE
+	#define A2D_INPUTS_PER_MODULE	16	//AN0 to AN15 unless config.h says otherwise
+#endif
+#define A2D_NUMBER_OF_CHANNELS	(A2D_NUMBER_OF_MODULES * A2D_INPUTS_PER_MODULE)
+
+//One bit per channel (bit 0 = channel 0), only as wide as the channels need
+#if A2D_NUMBER_OF_CHANNELS > 16
+	typedef unsigned long A2D_CHANNEL_MASK;
+#else
+	typedef unsigned int A2D_CHANNEL_MASK;
+#endif
 
 /*************    Enumeration     ***************/
 enum RESOLUTION
@@ -90,6 +282,71 @@ enum RESOLUTION
 	RESOLUTION_16_BIT	//6 (Max samples = 15)
 };
 
+enum SPIKE_FILTER
+{
+	FILTER_NONE,			//The samples are summed as they are (Default)
+	FILTER_MEDIAN,			//Every sample is replaced by the median of the parameter (3 or 5) samples around it
+	FILTER_TRIMMED_MEAN,	//The parameter (1 to 7) highest and lowest samples of each burst are replaced by the mean of the rest
+	FILTER_SIGMA			//Samples more than parameter/4 (1 to 63) standard deviations from the burst mean are replaced by the mean of the rest
+};
+
+enum CAPTURE_SOURCE
+{
+	CAPTURE_RAW_SAMPLES,	//Every raw 10-bit sample of the channel, as it comes from the converter
+	CAPTURE_VALUES			//Every value published, after decimation and before calibration and formatting
+};
+
+enum SCAN_MODE
+{
+	SCAN_MODE_ON_DEMAND,	//Each burst is started by A2D_Routine() and the converter stops until the next call
+	SCAN_MODE_CONTINUOUS,	//Split buffer ping-pong, the converter keeps sampling while the previous burst is processed
+	SCAN_MODE_TIMED			//As continuous, but Timer3 triggers every sample so they are evenly spaced (uses Timer3)
+};
+
+enum EVENT_RULE
+{
+	EVENT_EVERY_VALUE,	//The finished function is called for every new value (Default)
+	EVENT_ABOVE,		//Called when the value rises above the limit, re-arms once it drops below limit - hysteresis
+	EVENT_BELOW,		//Called when the value falls below the limit, re-arms once it rises above limit + hysteresis
+	EVENT_INSIDE,		//Called when the value enters the window (limit to upperLimit), re-arms once it is outside by more than the hysteresis
+	EVENT_OUTSIDE,		//Called when the value leaves the window (limit to upperLimit), re-arms once it is inside by at least the hysteresis
+	EVENT_CHANGE		//Called when the value is more than limit counts away from the value last reported
+};
+
+/*************    Structures      ***************/
+struct A2D_Channel_Telemetry
+{
+	unsigned long completions;		//Values published since the telemetry was reset
+	unsigned long period;			//Ticks between the last two published values
+	unsigned long minimumPeriod;	//Shortest period seen
+	unsigned long maximumPeriod;	//Longest period seen
+	unsigned long latency;			//Ticks from the end of the newest burst in the value until the value was published
+	unsigned long maximumLatency;	//Longest latency seen
+	unsigned int overruns;			//Bursts of this channel dropped because the burst ring was full
+	unsigned int rawMinimum;		//Smallest raw sample behind the latest value
+	unsigned int rawMaximum;		//Largest raw sample behind the latest value
+	unsigned int rawSamples;		//Number of raw samples behind the latest value
+	unsigned long rawVariance;		//Variance of the raw samples behind the latest value (counts squared)
+};
+
+struct A2D_Burst_Jitter
+{
+	unsigned long interval;			//Ticks between the ends of the last two bursts
+	unsigned long minimumInterval;	//Shortest interval seen
+	unsigned long maximumInterval;	//Longest interval seen
+	unsigned long averageInterval;	//Mean of every interval measured
+	unsigned long jitter;			//Longest - shortest interval
+	unsigned long intervals;		//Intervals measured since the jitter was reset
+};
+
+struct A2D_Telemetry
+{
+	unsigned long interruptTime;	//Ticks spent in the latest call to the ISR
+	unsigned long maxInterruptTime;	//Longest time spent in the ISR
+	unsigned long routineTime;		//Ticks spent in the latest call to A2D_Routine()
+	unsigned long maxRoutineTime;	//Longest time spent in A2D_Routine()
+};
+
 /***********State Machine Definitions************/
 /*************Function  Prototypes***************/
 /**
@@ -97,6 +354,7 @@ enum RESOLUTION
  */
 void A2D_Initialize(void);
 
+#ifndef A2D_STATIC_CHANNELS
 /**
  * Sets up the fundamental settings of the scan, allowing you to change the number of samples and increasing resolution, in addition to adding custom formating and inserting function before/after a scan as well as when a channel is finished scanning
  * @param channel The A2D channel that is to be scanned, these are enumerated in the controller config file
@@ -109,14 +367,195 @@ void A2D_Initialize(void);
  * @return 1 = Channel was updated successfully, 0 = Value out of range, no changes were made
  */
 int A2D_Channel_Settings(int channel, enum RESOLUTION desiredResolutionIncrease, int numberOfAverages, int (*formatPointer)(int), void (*preFunction)(int), void (*postFunction)(int), void (*finishedFunction)(int));
+#endif
+
+/**
+ * Selects whether the averaged value of a channel is rounded to the nearest count or truncated, takes effect on the next value
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param rounding 1 = Round to nearest, 0 = Truncate (Default)
+ * @return 1 = Success, 0 = Channel out of range
+ */
+int A2D_Channel_Rounding(int channel, int rounding);
+
+#ifdef A2D_LAZY_FORMATTING
+/**
+ * Selects whether the format function of a channel runs as each value is published, or when the value is next read
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param lazy 1 = Format on the first read of each new value, 0 = Format every value as it is published (Default)
+ * @return 1 = Success, 0 = Channel out of range
+ */
+int A2D_Channel_Lazy_Formatting(int channel, int lazy);
+#endif
+
+#ifdef A2D_EVENTS
+/**
+ * Sets the rule that decides which new values call the finished function of a channel, see enum EVENT_RULE in this header file
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param rule EVENT_EVERY_VALUE (default), EVENT_ABOVE, EVENT_BELOW, EVENT_INSIDE, EVENT_OUTSIDE or EVENT_CHANGE
+ * @param limit The threshold, the bottom of the window or the change required, in counts at the channel resolution (before formatting)
+ * @param upperLimit The top of the window (only used by EVENT_INSIDE and EVENT_OUTSIDE)
+ * @param hysteresis How far the value has to come back past the limit before the rule can fire again (not used by EVENT_CHANGE)
+ * @return 1 = Success, 0 = Value out of range, no changes were made
+ */
+int A2D_Channel_Event(int channel, enum EVENT_RULE rule, unsigned int limit, unsigned int upperLimit, unsigned int hysteresis);
+#endif
+
+#ifdef A2D_ADAPTIVE
+/**
+ * Lets the resolution of a channel drop during transients (for faster values) and climb back when the signal is steady
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param minimumResolution The lowest resolution allowed, the highest is the one in the channel settings. Setting them equal turns adaptive off
+ * @param threshold Change in the average of a burst, in raw 10-bit counts, from one burst to the next that counts as a transient
+ * @return 1 = Success, 0 = Value out of range or the channel is streaming, no changes were made
+ */
+int A2D_Channel_Adaptive(int channel, enum RESOLUTION minimumResolution, unsigned int threshold);
+#endif
+
+#ifdef A2D_FILTERS
+/**
+ * Sets the spike filter the raw samples of a channel go through before they are averaged, see enum SPIKE_FILTER in this header file
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param filter FILTER_NONE (default), FILTER_MEDIAN, FILTER_TRIMMED_MEAN or FILTER_SIGMA
+ * @param parameter The median window (3 or 5), the samples trimmed from each end (1 to 7) or the rejection limit in quarters of a standard deviation (1 to 63, eg 10 = 2.5 sigma)
+ * @return 1 = Success, 0 = Value out of range, no changes were made
+ */
+int A2D_Channel_Filter(int channel, enum SPIKE_FILTER filter, int parameter);
+#endif
+
+#ifdef A2D_CALIBRATION
+/**
+ * Sets the calibration applied to every value of a channel before it is formatted and published, see the notes above
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param offset Counts (at the channel resolution) added to each value before the gain
+ * @param gain Fixed point gain, A2D_UNITY_GAIN = 1.0
+ * @param table Outputs for segments + 1 evenly spaced inputs from 0 to the full scale of the channel, it must stay valid while in use. (void*)0 = No table
+ * @param segments The number of segments the table splits the range into, a power of two from 2 to 256 (ignored without a table)
+ * @return 1 = Success, 0 = Value out of range, no changes were made
+ */
+int A2D_Channel_Calibration(int channel, int offset, unsigned int gain, const int *table, int segments);
+
+/**
+ * Puts an array of values through the calibration of a channel, the same as each value would be when it is published
+ * @param channel The A2D channel whose calibration is used, these are enumerated in the controller config file
+ * @param raw Averaged values at the channel resolution (eg from a recording), before calibration
+ * @param calibrated Where the calibrated values are written, count of them
+ * @param count The number of values to calibrate
+ * @return 1 = Success, 0 = Value out of range
+ */
+int A2D_Calibrate(int channel, const unsigned int *raw, int *calibrated, int count);
+
+/**
+ * Puts records of several channels through their calibrations at once, eg a capture with one column per channel
+ * @param channels The channel of each column, these are enumerated in the controller config file
+ * @param numberOfChannels The number of columns (channels) in each record
+ * @param raw Records of averaged values, numberOfChannels values per record with the columns in the order of channels
+ * @param calibrated Where the calibrated records are written, in the same layout as raw
+ * @param records The number of records to calibrate
+ * @return 1 = Success, 0 = Value out of range, nothing was converted
+ */
+int A2D_Calibrate_Channels(const unsigned char *channels, int numberOfChannels, const unsigned int *raw, int *calibrated, int records);
+#endif
+
+#ifdef A2D_GATING
+/**
+ * Gates a channel, so it is only scanned while a value has been requested (A2D_Request() or a refresh interval)
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param gated 1 = Only scanned on request, 0 = Scanned all the time (Default), also clears any refresh interval
+ * @return 1 = Success, 0 = Channel out of range
+ */
+int A2D_Channel_Gating(int channel, int gated);
+
+/**
+ * Asks for a new value of a gated channel, it is scanned (from a fresh average) until the value is published
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @return 1 = Success (or the channel isn't gated, there is nothing to do), 0 = Channel out of range
+ */
+int A2D_Request(int channel);
+#endif
+
+#if defined(A2D_GATING) && defined(A2D_TIMESTAMP)
+/**
+ * Requests a new value of a channel automatically every so often, the channel is gated in between
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param interval A2D_TIMESTAMP() ticks from one request to the next, 0 = Only on A2D_Request() (the channel stays gated)
+ * @return 1 = Success, 0 = Channel out of range
+ */
+int A2D_Channel_Refresh_Interval(int channel, unsigned long interval);
+#endif
+
+/**
+ * Tells whether every module is powered down because nothing that is gated is due (and nothing else is being scanned)
+ * @return 1 = Every module is off, 0 = At least one module is scanning
+ */
+int A2D_Idle(void);
+
+/**
+ * Returns the resolution a channel is currently running at (only differs from the channel settings when adaptive)
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @return The current bits of resolution increase (see enum RESOLUTION), -1 = Channel out of range
+ */
+int A2D_Channel_Resolution(int channel);
+
+#ifdef A2D_STREAMING
+/**
+ * Turns a channel into a moving average that publishes a value every block rather than every average, see the notes above
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param segments Storage for the sliding window, one unsigned long per segment, it must stay valid while the channel is streaming
+ * @param length The number of segments (up to 255), the largest number that splits the average evenly is used. 0 or 1 turns streaming off
+ * @return 1 = Success, 0 = Value out of range, no changes were made
+ */
+int A2D_Channel_Streaming(int channel, unsigned long *segments, int length);
+#endif
+
+#ifdef A2D_CAPTURE
+/**
+ * Sets up (or re-arms) the capture ring of a channel, it starts empty and records until it has been triggered, see the notes above
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param buffer Storage for the ring, length entries, it must stay valid while the channel is capturing. (void*)0 = Stop capturing
+ * @param length The number of entries in the ring
+ * @param source CAPTURE_RAW_SAMPLES or CAPTURE_VALUES, see enum CAPTURE_SOURCE in this header file
+ * @param afterTrigger The number of entries recorded after the trigger before the ring is frozen (0 to length)
+ * @param below An entry below this triggers the capture (0 = Never)
+ * @param above An entry above this triggers the capture (0xFFFF = Never)
+ * @return 1 = Success, 0 = Value out of range, no changes were made
+ */
+int A2D_Channel_Capture(int channel, unsigned int *buffer, int length, enum CAPTURE_SOURCE source, int afterTrigger, unsigned int below, unsigned int above);
+
+/**
+ * Triggers the capture of a channel by hand, the ring is frozen once the entries after the trigger have been recorded
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @return 1 = Success, 0 = Channel out of range, not capturing or already triggered
+ */
+int A2D_Capture_Trigger(int channel);
 
 /**
- * Adds the channel to the scanning queue
+ * Points to the contents of the capture ring of a channel, oldest entry first, without copying it
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param first Set to the oldest entries
+ * @param firstLength Set to the number of entries at first
+ * @param second Set to the entries that follow on from first (the start of the ring)
+ * @param secondLength Set to the number of entries at second, 0 until the ring has wrapped
+ * @return 1 = The capture is frozen and won't change until it is re-armed, 0 = Still recording (or not capturing, or out of range)
+ */
+int A2D_Capture_Read(int channel, const unsigned int **first, int *firstLength, const unsigned int **second, int *secondLength);
+#endif
+
+/**
+ * Adds the channel to the scanning queue, calling it again for the same channel raises its weight by one
  * @param channel The channel that is to be added to the scanning queue, these are declared in the controller config file
- * @return 1 = Success, 0 = Failure - Channel out of range
+ * @return 1 = Success, 0 = Failure - Channel out of range or the schedule is full
  */
 int A2D_Add_To_Scan_Queue(int channel);
 
+/**
+ * Sets how many times per schedule cycle a channel is scanned, the schedule is recompiled straight away
+ * @param channel The channel that is to be weighted, these are declared in the controller config file
+ * @param weight The number of scans per cycle, 0 removes the channel from the schedule. The sum of all weights can not exceed 64
+ * (or the sum of the weights in A2D_STATIC_CHANNELS)
+ * @return 1 = Success, 0 = Failure - Channel out of range or the schedule would be too big, no changes were made
+ */
+int A2D_Scan_Weight(int channel, int weight);
+
 /**
  * Calculates and updates averaged/formatted result, through the magic of DSP it will also increase the resolution if required
  * Calling this function multiple times will only do something if a conversion has completed
@@ -124,10 +563,230 @@ int A2D_Add_To_Scan_Queue(int channel);
   */
 void A2D_Routine(void);
 
+/**
+ * Selects how bursts are triggered on AD1, changing modes restarts the current burst
+ * @param mode SCAN_MODE_ON_DEMAND (default), SCAN_MODE_CONTINUOUS or SCAN_MODE_TIMED, see enum SCAN_MODE in this header file
+ * @return 1 = Mode changed, 0 = Invalid mode, no changes were made
+ */
+int A2D_Scan_Mode(enum SCAN_MODE mode);
+
+/**
+ * Selects how bursts are triggered on one module, changing modes restarts the current burst of that module
+ * @param module 0 = AD1, 1 = AD2
+ * @param mode SCAN_MODE_ON_DEMAND (default), SCAN_MODE_CONTINUOUS or SCAN_MODE_TIMED (AD1 only)
+ * @return 1 = Mode changed, 0 = Invalid module or mode, no changes were made
+ */
+int A2D_Module_Scan_Mode(int module, enum SCAN_MODE mode);
+
+/**
+ * Sets the time between samples in SCAN_MODE_TIMED, takes effect straight away if already timed
+ * @param cycles Instruction cycles between samples (Timer3 period, 1:1 prescale), must be at least one sample and conversion at the AD1CON3 settings, (SAMC + 12) TAD (Default is A2D_SAMPLE_PERIOD)
+ * @return 1 = Success, 0 = Shorter than one conversion, no changes were made
+ */
+int A2D_Sample_Period(unsigned int cycles);
+
+#ifdef A2D_TIMESTAMP
+/**
+ * Copies the burst to burst timing of AD1, only available when A2D_TIMESTAMP() is defined in the config file
+ * @param statistics Filled in with the interval between bursts (in A2D_TIMESTAMP() ticks) and its spread
+ */
+void A2D_Burst_Jitter(struct A2D_Burst_Jitter *statistics);
+
+/**
+ * Copies the burst to burst timing of one module, only available when A2D_TIMESTAMP() is defined in the config file
+ * @param module 0 = AD1, 1 = AD2
+ * @param statistics Filled in with the interval between bursts (in A2D_TIMESTAMP() ticks) and its spread
+ * @return 1 = Success, 0 = Module out of range
+ */
+int A2D_Module_Burst_Jitter(int module, struct A2D_Burst_Jitter *statistics);
+
+/**
+ * Clears the burst to burst timing of AD1, only available when A2D_TIMESTAMP() is defined in the config file
+ */
+void A2D_Reset_Jitter(void);
+
+/**
+ * Clears the burst to burst timing of one module, only available when A2D_TIMESTAMP() is defined in the config file
+ * @param module 0 = AD1, 1 = AD2
+ * @return 1 = Success, 0 = Module out of range
+ */
+int A2D_Module_Reset_Jitter(int module);
+#endif
+
+/**
+ * Sets how many queue channels may be scanned together in a single burst on AD1 (Default is 1)
+ * @param channels The most channels sharing a burst, between 1 and 16
+ * @return 1 = Success, 0 = Value out of range, no changes were made
+ */
+int A2D_Channels_Per_Burst(int channels);
+
+/**
+ * Sets how many queue channels may be scanned together in a single burst on one module (Default is 1)
+ * @param module 0 = AD1, 1 = AD2
+ * @param channels The most channels sharing a burst, between 1 and 16
+ * @return 1 = Success, 0 = Value out of range, no changes were made
+ */
+int A2D_Module_Channels_Per_Burst(int module, int channels);
+
+/**
+ * Returns the number of AD1 bursts dropped because the ring between the ISR and A2D_Routine() was full
+ * @return Dropped bursts since A2D_Initialize() (wraps at 65536)
+ */
+unsigned int A2D_Dropped_Bursts(void);
+
+/**
+ * Returns the number of bursts of one module dropped because its ring was full
+ * @param module 0 = AD1, 1 = AD2
+ * @return Dropped bursts since A2D_Initialize() (wraps at 65536), 0 = Module out of range
+ */
+unsigned int A2D_Module_Dropped_Bursts(int module);
+
+/**
+ * Returns the most AD1 bursts that have been waiting for A2D_Routine() at once
+ * @return High-water mark of the burst ring since A2D_Initialize(), A2D_BURST_RING_SIZE means it has been full
+ */
+int A2D_Burst_High_Water_Mark(void);
+
+/**
+ * Returns the most bursts of one module that have been waiting for A2D_Routine() at once
+ * @param module 0 = AD1, 1 = AD2
+ * @return High-water mark of the module's burst ring since A2D_Initialize(), 0 = Module out of range
+ */
+int A2D_Module_Burst_High_Water_Mark(int module);
+
+#ifdef A2D_TELEMETRY
+/**
+ * Copies the telemetry of a channel, only available when A2D_TELEMETRY is defined in the config file
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param statistics Filled in with the telemetry of the channel
+ * @return 1 = Success, 0 = Channel out of range
+ */
+int A2D_Channel_Telemetry(int channel, struct A2D_Channel_Telemetry *statistics);
+
+/**
+ * Copies the ISR and A2D_Routine() timing, only available when A2D_TELEMETRY is defined in the config file
+ * @param statistics Filled in with the module wide telemetry
+ */
+void A2D_Telemetry(struct A2D_Telemetry *statistics);
+
+/**
+ * Clears all telemetry, only available when A2D_TELEMETRY is defined in the config file
+ */
+void A2D_Reset_Telemetry(void);
+#endif
+
+/**
+ * Reads several channels in one pass, optionally skipping the channels that haven't changed since the last read
+ * @param channelMask One bit per channel to read (bit 0 = channel 0)
+ * @param values Array indexed by channel, only the channels read are written
+ * @param sequences Array indexed by channel of the sequence numbers from the last read, updated for every channel read. (void*)0 reads every channel in the mask
+ * @param changed Set to one bit per channel that was read (ie had changed), (void*)0 if not needed
+ * @return 1 = The values are a consistent snapshot, 0 = Values were being published during the read, try again
+ */
+int A2D_Read_Channels(A2D_CHANNEL_MASK channelMask, int *values, unsigned int *sequences, A2D_CHANNEL_MASK *changed);
+
+/**
+ * Returns the sequence counter of a channel, it increases by one every time a new value is published
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @return The sequence number of the current value, 0 = No value yet (or channel out of range)
+ */
+unsigned int A2D_Sequence(int channel);
+
+#ifdef A2D_DEADLINES
+/**
+ * Sets the longest acceptable time between values of a channel, used by the planner and admission control
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param maximumPeriod The deadline in A2D_Planner_Burst_Time() ticks, 0 = No deadline
+ * @return 1 = Success, 0 = Channel out of range or (with admission control) the deadline can't be met, no changes were made
+ */
+int A2D_Channel_Deadline(int channel, unsigned long maximumPeriod);
+#endif
+
+/**
+ * Predicts the time between values of a channel with the current schedule and settings
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @return The predicted update period in A2D_Planner_Burst_Time() ticks, 0xFFFFFFFF = The channel is not scanned
+ */
+unsigned long A2D_Predicted_Period(int channel);
+
+#ifdef A2D_DEADLINES
+/**
+ * Returns how far inside its deadline a channel is predicted to update
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @return Deadline - predicted period in ticks (negative = deadline missed), 0x7FFFFFFF = No deadline
+ */
+long A2D_Channel_Slack(int channel);
+
+/**
+ * Lists the channels that are predicted to miss their deadlines
+ * @return One bit per channel (bit 0 = channel 0), 0 = Every deadline is met
+ */
+A2D_CHANNEL_MASK A2D_Missed_Deadlines(void);
+#endif
+
+/**
+ * Sets how long a single AD1 burst takes, the unit of every period and deadline (Default is A2D_BURST_TIME, 1 unless set in the config file)
+ * @param ticks The time of one burst (eg the main loop time in on-demand mode, 16 conversions in continuous mode)
+ */
+void A2D_Planner_Burst_Time(unsigned long ticks);
+
+/**
+ * Sets how long a single burst of one module takes, periods of the channels on that module are counted in these ticks
+ * @param module 0 = AD1, 1 = AD2
+ * @param ticks The time of one burst, in the same unit as the deadlines
+ * @return 1 = Success, 0 = Module out of range
+ */
+int A2D_Module_Planner_Burst_Time(int module, unsigned long ticks);
+
+#ifdef A2D_DEADLINES
+/**
+ * Turns admission control on or off (Default is off), when on any change that makes a channel miss its deadline is refused
+ * @param enable 1 = Refuse changes that miss a deadline, 0 = Allow them (A2D_Missed_Deadlines() still reports them)
+ */
+void A2D_Admission_Control(int enable);
+#endif
+
+/**
+ * Returns the number of bursts in one cycle of the compiled AD1 schedule
+ * @return Bursts per schedule cycle
+ */
+int A2D_Schedule_Length(void);
+
+/**
+ * Returns the number of bursts in one cycle of the compiled schedule of one module
+ * @param module 0 = AD1, 1 = AD2
+ * @return Bursts per schedule cycle, 0 = Module out of range
+ */
+int A2D_Module_Schedule_Length(int module);
+
+/**
+ * Returns the channels scanned in one burst of the compiled AD1 schedule
+ * @param slot The burst, between 0 and A2D_Schedule_Length() - 1
+ * @return CSSL (and CSSH) mask of the burst (bit 0 = channel 0), 0 = Slot out of range
+ */
+A2D_CHANNEL_MASK A2D_Schedule_Mask(int slot);
+
+/**
+ * Returns the inputs scanned in one burst of the compiled schedule of one module
+ * @param module 0 = AD1, 1 = AD2
+ * @param slot The burst, between 0 and A2D_Module_Schedule_Length() - 1
+ * @return CSSL (and CSSH) mask of the burst (bit 0 = the module's AN0), 0 = Module or slot out of range
+ */
+A2D_CHANNEL_MASK A2D_Module_Schedule_Mask(int module, int slot);
+
+/**
+ * Processes raw samples of a channel as if they had been scanned as a burst of that channel alone (for replaying recordings)
+ * @param channel The A2D channel, these are enumerated in the controller config file
+ * @param samples Raw 10-bit samples in the order they were taken
+ * @param count The number of samples, between 1 and 16
+ * @return 1 = Success, 0 = Channel or count out of range, nothing was processed
+ */
+int A2D_Process_Burst(int channel, unsigned int *samples, int count);
+
 /**
  * Returns the current value of the selected channel (Optionally formatted)
  * @param channel The analog channel that you require the formatted value of, these are declared in the controller config file
- * @return The formatted A2D values
+ * @return The formatted A2D values, 0 if the channel is out of range (or not in A2D_STATIC_CHANNELS)
  */
 int A2D_Value(int channel);
 
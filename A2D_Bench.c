@@ -0,0 +1,999 @@
+/**************************************************************************************************
+Target Hardware:		Linux host (gcc/clang)
+Chip resources used:	None, runs A2D.c against the simulated AD1 module (A2D_Sim.c)
+Purpose:				Time the hot paths and update rates of the library and cross-check its pipeline, before and after a change
+
+Build with a host config.h that includes A2D_Sim.h (without A2D_STATIC_CHANNELS, the bench sets its own channels up):
+	gcc -O2 -I<config dir> A2D_Bench.c A2D.c A2D_Sim.c -lm -o A2D_Bench
+Define A2D_TIMESTAMP() as A2D_SIM_TIMESTAMP() in that config.h to have the timed scanning jitter checked as well, and the
+optional features (A2D_EVENTS, A2D_ADAPTIVE, A2D_CALIBRATION, A2D_CAPTURE, A2D_STREAMING, A2D_FILTERS and A2D_GATING) to
+have them checked, the checks for anything not compiled in are skipped.
+Usage:
+	A2D_Bench [bench | check]
+bench - Host time per call of A2D_Routine(), the ISR, A2D_Scan_Weight() (compiles the schedule, what used to be the queue
+		search), A2D_Channel_Settings() and the decimation (against the divide it replaced), then the update rate of a
+		channel against the number of channels scanned and the resolution, in the simulated time of a 16 MIPS part (next to
+		the rate the planner predicts when scanning continuously)
+check - Cross-checks every stage of the pipeline against a reference: the decimation against a divide for every valid
+		setting, the scan modes (timed included, and its shortest sample period), multi-channel bursts and AD2 against each
+		other, replayed samples against scanned ones, the share of the scans each weight gets, the burst ring, streaming,
+		the snapshot read, spike filters, event rules, adaptive oversampling, batch calibration, gating and capture
+Both are run without an argument. The exit code is 1 if any cross-check fails, 2 for a bad argument.
+
+Host times are in nanoseconds, the mean and 99.9th percentile with the slowest 0.1% (the host scheduling something else in)
+left out. They only mean something relative to each other (eg before and after a change), they are not the time the PIC24
+takes. Update rates are worked out from simulated instruction cycles and are what the part would see.
+
+Version History:
+v1.0.0	2026-10-18  agent
+	First version
+ **************************************************************************************************/
+/*************    Header Files    ***************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Config.h"
+#include "A2D.h"
+
+#ifdef A2D_STATIC_CHANNELS
+	#error "The bench sets its own channels up, build it with a config.h that doesn't define A2D_STATIC_CHANNELS"
+#endif
+#if A2D_INPUTS_PER_MODULE < 16
+	#error "The bench scans up to 16 channels on AD1"
+#endif
+
+/*************   Magic  Numbers   ***************/
+#define BENCH_CHANNELS		16
+#define SAMPLES_PER_BURST	16
+#define TIMED_CALLS			20000		//Calls timed for each per call figure
+#define INSTRUCTION_RATE	16000000ul	//Instruction cycles per second the update rates are quoted at (16 MIPS)
+#define MAIN_LOOP_CYCLES	500			//Instruction cycles the simulated main loop takes between A2D_Routine() calls
+#define RECORD_LENGTH		8192		//Samples of AN0 recorded for the replay check
+
+/*************  Global Variables  ***************/
+int checksRun;
+int checksFailed;
+double timerOverhead;
+double times[TIMED_CALLS];
+int finishedCalls;
+unsigned int recorded[RECORD_LENGTH];
+int recordedLength;
+unsigned long sourceSeed;
+
+/*************Function  Prototypes***************/
+unsigned long Decimate(int channel, unsigned long sum);	//Internal to A2D.c, benchmarked and checked directly
+double Now(void);
+int Compare_Times(const void *a, const void *b);
+void Summarise(double *mean, double *worst);
+void Check(int passed, const char *description);
+void Restart(void);
+int Setup_Channel(int channel, enum RESOLUTION resolution, int averages, int weight);
+int Run_Until(int channel, unsigned int values, unsigned long limit);
+int Recorded_Source(int input, unsigned long long cycle);
+void Count_Finished(int channel);
+void Bench_Routine(void);
+void Bench_Interrupt(void);
+void Bench_Schedule(void);
+void Bench_Settings(void);
+void Bench_Decimation(void);
+void Bench_Update_Rate(enum SCAN_MODE mode);
+void Check_Decimation(void);
+void Check_Scan_Modes(void);
+void Check_Schedule_Share(void);
+void Check_Second_Module(void);
+void Check_Replay(void);
+void Check_Burst_Ring(void);
+void Check_Streaming(void);
+void Check_Snapshot(void);
+void Check_Filters(void);
+void Check_Events(void);
+void Check_Adaptive(void);
+void Check_Timed(void);
+void Check_Calibration(void);
+void Check_Gating(void);
+void Check_Capture(void);
+
+int main(int argc, char *argv[])
+{
+	int bench = 1;
+	int check = 1;
+	double start;
+	int call;
+
+	if(argc > 1)
+	{
+		bench = strcmp(argv[1], "bench") == 0;
+		check = strcmp(argv[1], "check") == 0;
+		if(!bench && !check)
+		{
+			fprintf(stderr, "Usage: %s [bench | check]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	//What reading the clock costs (the median of back to back reads) is taken back off every per call figure
+	for(call = 0; call < TIMED_CALLS; call++)
+	{
+		start = Now();
+		times[call] = Now() - start;
+	}
+	qsort(times, TIMED_CALLS, sizeof(times[0]), Compare_Times);
+	timerOverhead = times[TIMED_CALLS / 2];
+
+	if(bench)
+	{
+		printf("Per call host time (ns), mean and 99.9th percentile of %d calls\n", TIMED_CALLS);
+		Bench_Routine();
+		Bench_Interrupt();
+		Bench_Schedule();
+		Bench_Settings();
+		Bench_Decimation();
+		Bench_Update_Rate(SCAN_MODE_ON_DEMAND);
+		Bench_Update_Rate(SCAN_MODE_CONTINUOUS);
+	}
+
+	if(check)
+	{
+		printf("\nCross-checks\n");
+		Check_Decimation();
+		Check_Scan_Modes();
+		Check_Schedule_Share();
+		Check_Second_Module();
+		Check_Replay();
+		Check_Burst_Ring();
+		Check_Streaming();
+		Check_Snapshot();
+		Check_Filters();
+		Check_Events();
+		Check_Adaptive();
+		Check_Timed();
+		Check_Calibration();
+		Check_Gating();
+		Check_Capture();
+		printf("%d of %d checks passed\n", checksRun - checksFailed, checksRun);
+	}
+
+	return checksFailed ? 1 : 0;
+}
+
+double Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+int Compare_Times(const void *a, const void *b)
+{
+	return (*(const double*)a > *(const double*)b) - (*(const double*)a < *(const double*)b);
+}
+
+void Summarise(double *mean, double *worst)
+{
+	double total = 0;
+	int kept = TIMED_CALLS - TIMED_CALLS / 1000;
+	int call;
+
+	//The slowest 0.1% are the host scheduling something else in, not the library
+	qsort(times, TIMED_CALLS, sizeof(times[0]), Compare_Times);
+	for(call = 0; call < kept; call++)
+		total += times[call];
+	*mean = total / kept - timerOverhead;
+	*worst = times[kept - 1] - timerOverhead;
+	if(*mean < 0)
+		*mean = 0;
+	if(*worst < 0)
+		*worst = 0;
+
+	return;
+}
+
+void Check(int passed, const char *description)
+{
+	checksRun++;
+	if(!passed)
+		checksFailed++;
+	printf("  %-4s %s\n", passed ? "ok" : "FAIL", description);
+
+	return;
+}
+
+void Restart(void)
+{
+	A2D_Sim_Reset();
+	A2D_Initialize();
+
+	return;
+}
+
+int Setup_Channel(int channel, enum RESOLUTION resolution, int averages, int weight)
+{
+	//A2D_Initialize() leaves the options of a channel alone, put them back to their defaults
+	#ifdef A2D_STREAMING
+		A2D_Channel_Streaming(channel, (void*)0, 0);
+	#endif
+	#ifdef A2D_FILTERS
+		A2D_Channel_Filter(channel, FILTER_NONE, 0);
+	#endif
+	A2D_Channel_Rounding(channel, 0);
+	#ifdef A2D_LAZY_FORMATTING
+		A2D_Channel_Lazy_Formatting(channel, 0);
+	#endif
+	#ifdef A2D_EVENTS
+		A2D_Channel_Event(channel, EVENT_EVERY_VALUE, 0, 0, 0);
+	#endif
+	#ifdef A2D_GATING
+		A2D_Channel_Gating(channel, 0);
+	#endif
+	#ifdef A2D_CAPTURE
+		A2D_Channel_Capture(channel, (void*)0, 0, CAPTURE_RAW_SAMPLES, 0, 0, 0xFFFF);
+	#endif
+
+	if(!A2D_Channel_Settings(channel, resolution, averages, NO_FORMATING, NO_PREFUNCTION, NO_POSTFUNCTION, Count_Finished))
+		return 0;
+
+	return A2D_Scan_Weight(channel, weight);
+}
+
+int Run_Until(int channel, unsigned int values, unsigned long limit)
+{
+	unsigned int start = A2D_Sequence(channel);
+	unsigned long cycles;
+
+	//The main loop, until the channel has published that many more values or the time runs out (sequences carry on through A2D_Initialize())
+	for(cycles = 0; (A2D_Sequence(channel) - start < values) && (cycles < limit); cycles += MAIN_LOOP_CYCLES)
+	{
+		A2D_Routine();
+		A2D_Sim_Run(MAIN_LOOP_CYCLES);
+	}
+	A2D_Routine();
+
+	return A2D_Sequence(channel) - start >= values;
+}
+
+int Recorded_Source(int input, unsigned long long cycle)
+{
+	unsigned int sample;
+
+	//A deterministic noisy signal, every sample handed to AN0 is kept so it can be replayed
+	sourceSeed = sourceSeed * 1103515245ul + 12345ul;
+	sample = 300 + (unsigned int)((cycle >> 10) % 400) + (unsigned int)((sourceSeed >> 16) % 64);
+	if((input == 0) && (recordedLength < RECORD_LENGTH))
+		recorded[recordedLength++] = sample;
+
+	return (int)sample;
+}
+
+void Count_Finished(int channel)
+{
+	finishedCalls++;
+
+	return;
+}
+
+void Bench_Routine(void)
+{
+	const int depths[] = {1, 4, 16};
+	double start;
+	double mean;
+	double worst;
+	int depth;
+	int channel;
+	int call;
+	int mode;
+
+	//The simulator runs between calls but isn't timed, a call processes whatever bursts finished since the last one
+	for(mode = SCAN_MODE_ON_DEMAND; mode <= SCAN_MODE_CONTINUOUS; mode++)
+		for(depth = 0; depth < (int)(sizeof(depths)/sizeof(depths[0])); depth++)
+		{
+			Restart();
+			for(channel = 0; channel < depths[depth]; channel++)
+			{
+				A2D_Sim_Waveform(channel, A2D_SIM_SINE, 512, 400, 100000ul + channel * 7919ul, 8);
+				Setup_Channel(channel, RESOLUTION_12_BIT, 4, 1);
+			}
+			A2D_Scan_Mode(mode);
+
+			for(call = 0; call < TIMED_CALLS; call++)
+			{
+				start = Now();
+				A2D_Routine();
+				times[call] = Now() - start;
+				A2D_Sim_Run(MAIN_LOOP_CYCLES);
+			}
+			Summarise(&mean, &worst);
+			printf("  A2D_Routine()           %-10s %2d channel(s)  %8.1f %8.1f\n", (mode == SCAN_MODE_ON_DEMAND) ? "on demand" : "continuous",
+				depths[depth], mean, worst);
+		}
+
+	return;
+}
+
+void Bench_Interrupt(void)
+{
+	const int perBurst[] = {1, 4};
+	double start;
+	double mean;
+	double worst;
+	int index;
+	int channel;
+	int call;
+	int mode;
+
+	//The ISR is called by hand on a finished buffer, A2D_Routine() takes the burst off it between calls (not timed)
+	for(mode = SCAN_MODE_ON_DEMAND; mode <= SCAN_MODE_CONTINUOUS; mode++)
+		for(index = 0; index < (int)(sizeof(perBurst)/sizeof(perBurst[0])); index++)
+		{
+			Restart();
+			for(channel = 0; channel < 4; channel++)
+			{
+				A2D_Sim_Waveform(channel, A2D_SIM_DC, 100 + channel * 200, 0, 1, 0);
+				Setup_Channel(channel, RESOLUTION_12_BIT, 4, 1);
+			}
+			A2D_Channels_Per_Burst(perBurst[index]);
+			A2D_Scan_Mode(mode);
+			A2D_Routine();
+
+			for(call = 0; call < TIMED_CALLS; call++)
+			{
+				start = Now();
+				_ADC1Interrupt();
+				times[call] = Now() - start;
+				A2D_Routine();
+			}
+			Summarise(&mean, &worst);
+			printf("  _ADC1Interrupt()        %-10s %2d per burst   %8.1f %8.1f\n", (mode == SCAN_MODE_ON_DEMAND) ? "on demand" : "continuous",
+				perBurst[index], mean, worst);
+		}
+
+	return;
+}
+
+void Bench_Schedule(void)
+{
+	const int depths[] = {1, 4, 16};
+	double start;
+	double mean;
+	double worst;
+	int depth;
+	int channel;
+	int call;
+
+	//Changing a weight compiles the whole schedule, the heaviest channel swaps between two weights so it changes every call
+	for(depth = 0; depth < (int)(sizeof(depths)/sizeof(depths[0])); depth++)
+	{
+		Restart();
+		for(channel = 0; channel < depths[depth]; channel++)
+			Setup_Channel(channel, RESOLUTION_10_BIT, 16, 3);
+
+		for(call = 0; call < TIMED_CALLS; call++)
+		{
+			start = Now();
+			A2D_Scan_Weight(0, 3 + (call & 1));
+			times[call] = Now() - start;
+		}
+		Summarise(&mean, &worst);
+		printf("  A2D_Scan_Weight()       %2d channel(s), %2d slots   %8.1f %8.1f\n", depths[depth], A2D_Schedule_Length(), mean, worst);
+	}
+
+	return;
+}
+
+void Bench_Settings(void)
+{
+	double start;
+	double mean;
+	double worst;
+	int resolution;
+	int call;
+
+	Restart();
+	for(resolution = RESOLUTION_10_BIT; resolution <= RESOLUTION_16_BIT; resolution += 2)
+	{
+		for(call = 0; call < TIMED_CALLS; call++)
+		{
+			//Odd averages (where the resolution allows them) so the reciprocal has to be worked out as well
+			start = Now();
+			A2D_Channel_Settings(0, resolution, (resolution == RESOLUTION_16_BIT) ? 15 : (call & 1) ? 48 : 80, NO_FORMATING, NO_PREFUNCTION, NO_POSTFUNCTION, NO_FINISHED_FUNCTION);
+			times[call] = Now() - start;
+		}
+		Summarise(&mean, &worst);
+		printf("  A2D_Channel_Settings()  %2d bit                    %8.1f %8.1f\n", 10 + resolution, mean, worst);
+	}
+
+	return;
+}
+
+void Bench_Decimation(void)
+{
+	static unsigned long sums[4096];
+	volatile unsigned long divisor = 48ul << RESOLUTION_12_BIT;
+	volatile unsigned long sink = 0;
+	double start;
+	double multiply;
+	double divide;
+	int round;
+	int sum;
+
+	//A divisor with an odd part (3) so the reciprocal is used, against the plain divide it replaced
+	Restart();
+	Setup_Channel(0, RESOLUTION_12_BIT, 48, 0);
+	for(sum = 0; sum < 4096; sum++)
+		sums[sum] = ((unsigned long)sum * 196613ul) % (48ul * 16 * 1023 + 1);
+
+	start = Now();
+	for(round = 0; round < 100; round++)
+		for(sum = 0; sum < 4096; sum++)
+			sink += Decimate(0, sums[sum]);
+	multiply = (Now() - start) / (100.0 * 4096);
+
+	start = Now();
+	for(round = 0; round < 100; round++)
+		for(sum = 0; sum < 4096; sum++)
+			sink += sums[sum] / divisor;
+	divide = (Now() - start) / (100.0 * 4096);
+
+	printf("  Decimate()              12 bit, 48 averages       %8.1f\n", multiply);
+	printf("  sum / divisor           the same divide           %8.1f\n", divide);
+
+	return;
+}
+
+void Bench_Update_Rate(enum SCAN_MODE mode)
+{
+	const int depths[] = {1, 2, 4, 8, 16};
+	unsigned long cycles;
+	unsigned int first;
+	int resolution;
+	int depth;
+	int channel;
+
+	//Values per second of channel 0 over a second of simulated time, once the first value is out of the way
+	printf("\nUpdate rate of a channel (values/s at 16 MIPS), %s, %s\n", (mode == SCAN_MODE_ON_DEMAND) ? "on demand" : "continuous",
+		(mode == SCAN_MODE_ON_DEMAND) ? "A2D_Routine() every 500 cycles" : "predicted rate in brackets");
+	printf("  Resolution");
+	for(depth = 0; depth < (int)(sizeof(depths)/sizeof(depths[0])); depth++)
+		printf("  %2d channel(s)    ", depths[depth]);
+	printf("\n");
+
+	for(resolution = RESOLUTION_10_BIT; resolution <= RESOLUTION_16_BIT; resolution += 2)
+	{
+		printf("  %2d bit     ", 10 + resolution);
+		for(depth = 0; depth < (int)(sizeof(depths)/sizeof(depths[0])); depth++)
+		{
+			Restart();
+			for(channel = 0; channel < depths[depth]; channel++)
+			{
+				A2D_Sim_Waveform(channel, A2D_SIM_DC, 512, 0, 1, 0);
+				Setup_Channel(channel, resolution, (resolution == RESOLUTION_10_BIT) ? 16 : 1, 1);
+			}
+			A2D_Scan_Mode(mode);
+			A2D_Planner_Burst_Time(SAMPLES_PER_BURST * A2D_Sim_Cycles_Per_Sample());
+
+			Run_Until(0, 1, 10 * INSTRUCTION_RATE);
+			first = A2D_Sequence(0);
+			for(cycles = 0; cycles < INSTRUCTION_RATE; cycles += MAIN_LOOP_CYCLES)
+			{
+				A2D_Routine();
+				A2D_Sim_Run(MAIN_LOOP_CYCLES);
+			}
+
+			if(mode == SCAN_MODE_ON_DEMAND)
+				printf("  %8u          ", A2D_Sequence(0) - first);
+			else
+				printf("  %8u (%6lu)", A2D_Sequence(0) - first, INSTRUCTION_RATE / A2D_Predicted_Period(0));
+		}
+		printf("\n");
+	}
+
+	return;
+}
+
+void Check_Decimation(void)
+{
+	unsigned long samples;
+	unsigned long divisor;
+	unsigned long maximum;
+	unsigned long sum;
+	unsigned long expected;
+	long settings = 0;
+	long wrong = 0;
+	int resolution;
+	int averages;
+	int round;
+	int step;
+
+	//Every valid resolution/averages pair, the top sums and the sums either side of each multiple of the divisor
+	Restart();
+	for(resolution = RESOLUTION_10_BIT; resolution <= RESOLUTION_16_BIT; resolution++)
+		for(averages = 1; averages < 65536; averages++)
+		{
+			if(!A2D_Channel_Settings(0, resolution, averages, NO_FORMATING, NO_PREFUNCTION, NO_POSTFUNCTION, NO_FINISHED_FUNCTION))
+				continue;
+			settings++;
+			samples = (unsigned long)averages << (2 * resolution);
+			divisor = (unsigned long)averages << resolution;
+			maximum = (1ul << (10 + resolution)) - 1;
+			for(round = 0; round < 2; round++)
+			{
+				A2D_Channel_Rounding(0, round);
+				for(step = 0; step < 256; step++)
+				{
+					sum = (step < 64) ? samples * 1023 - step : ((samples * 1023 / 192) * (step - 64) / divisor) * divisor + (step & 1) * (divisor - 1);
+					expected = (sum + (round ? divisor / 2 : 0)) / divisor;
+					if(expected > maximum)
+						expected = maximum;
+					if(Decimate(0, sum) != expected)
+						wrong++;
+				}
+			}
+		}
+
+	printf("  %ld settings, %ld wrong\n", settings, wrong);
+	Check((settings == 13641) && (wrong == 0), "Decimation matches sum / (averages * 2^b) for every valid setting, with and without rounding");
+
+	return;
+}
+
+void Check_Scan_Modes(void)
+{
+	const int levels[] = {100, 512, 1000};
+	int passed;
+	int channel;
+	int mode;
+	int perBurst;
+
+	//Clean DC inputs have to give exactly level * 4 at 12 bits whichever way they are scanned
+	for(mode = SCAN_MODE_ON_DEMAND; mode <= SCAN_MODE_TIMED; mode++)
+		for(perBurst = 1; perBurst <= 3; perBurst += 2)
+		{
+			Restart();
+			for(channel = 0; channel < 3; channel++)
+			{
+				A2D_Sim_Waveform(channel, A2D_SIM_DC, levels[channel], 0, 1, 0);
+				Setup_Channel(channel, RESOLUTION_12_BIT, 4, 1);
+			}
+			A2D_Channels_Per_Burst(perBurst);
+			A2D_Scan_Mode(mode);
+
+			passed = 1;
+			for(channel = 0; channel < 3; channel++)
+				passed &= Run_Until(channel, 3, 100 * INSTRUCTION_RATE / 16) && (A2D_Value(channel) == levels[channel] * 4);
+			printf("  %-4s %s, %d channel(s) per burst: %d %d %d\n", passed ? "ok" : "FAIL", (mode == SCAN_MODE_ON_DEMAND) ? "On demand" :
+				(mode == SCAN_MODE_CONTINUOUS) ? "Continuous" : "Timed", perBurst, A2D_Value(0), A2D_Value(1), A2D_Value(2));
+			checksRun++;
+			checksFailed += !passed;
+		}
+
+	return;
+}
+
+void Check_Schedule_Share(void)
+{
+	unsigned int first[BENCH_CHANNELS];
+	unsigned int values[BENCH_CHANNELS];
+	unsigned int least = 0xFFFF;
+	unsigned int most = 0;
+	unsigned long cycles;
+	int channel;
+
+	//Channel 0 has a weight of 3 and the rest 1, with the same settings it has to publish three times as often as each of them
+	Restart();
+	for(channel = 0; channel < BENCH_CHANNELS; channel++)
+	{
+		A2D_Sim_Waveform(channel, A2D_SIM_DC, 300 + channel, 0, 1, 0);
+		Setup_Channel(channel, RESOLUTION_10_BIT, 16, (channel == 0) ? 3 : 1);
+		first[channel] = A2D_Sequence(channel);
+	}
+	for(cycles = 0; cycles < INSTRUCTION_RATE; cycles += MAIN_LOOP_CYCLES)
+	{
+		A2D_Routine();
+		A2D_Sim_Run(MAIN_LOOP_CYCLES);
+	}
+	for(channel = 1; channel < BENCH_CHANNELS; channel++)
+	{
+		values[channel] = A2D_Sequence(channel) - first[channel];
+		least = (values[channel] < least) ? values[channel] : least;
+		most = (values[channel] > most) ? values[channel] : most;
+	}
+	values[0] = A2D_Sequence(0) - first[0];
+	Check((least > 0) && (most - least <= 1) && (values[0] + 3 >= 3 * least) && (values[0] <= 3 * most + 3), "Every channel gets the share of the scans its weight asks for");
+
+	return;
+}
+
+void Check_Second_Module(void)
+{
+	#if A2D_NUMBER_OF_MODULES > 1
+		int passed;
+
+		//AD2 scanning continuously beside an on demand AD1, both have to see their own input exactly
+		Restart();
+		A2D_Sim_Waveform(3, A2D_SIM_DC, 250, 0, 1, 0);
+		A2D_Sim_Waveform(5, A2D_SIM_DC, 750, 0, 1, 0);
+		Setup_Channel(3, RESOLUTION_12_BIT, 4, 1);
+		Setup_Channel(A2D_INPUTS_PER_MODULE + 5, RESOLUTION_12_BIT, 4, 1);
+		A2D_Module_Scan_Mode(1, SCAN_MODE_CONTINUOUS);
+		passed = Run_Until(3, 3, INSTRUCTION_RATE) && Run_Until(A2D_INPUTS_PER_MODULE + 5, 3, INSTRUCTION_RATE);
+		Check(passed && (A2D_Value(3) == 1000) && (A2D_Value(A2D_INPUTS_PER_MODULE + 5) == 3000) && (A2D_Module_Dropped_Bursts(1) == 0),
+			"AD2 scans its own channels alongside AD1");
+	#else
+		printf("  skip Second module, A2D_NUMBER_OF_MODULES is 1\n");
+	#endif
+
+	return;
+}
+
+void Check_Replay(void)
+{
+	unsigned int scanned[64];
+	unsigned int sequence;
+	int values;
+	int value;
+	int sample;
+	int matched = 1;
+
+	//AN0 is scanned from a recorded source, then the same samples are replayed into channel 1 which has the same settings
+	Restart();
+	recordedLength = 0;
+	sourceSeed = 1;
+	A2D_Sim_Source(0, Recorded_Source);
+	Setup_Channel(0, RESOLUTION_12_BIT, 4, 1);
+	Setup_Channel(1, RESOLUTION_12_BIT, 4, 0);
+
+	for(values = 0; values < 64; values++)
+	{
+		Run_Until(0, 1, INSTRUCTION_RATE);
+		scanned[values] = A2D_Value(0);
+	}
+
+	//Only the samples that made it into a value are replayed, the burst in flight at the end doesn't count
+	sequence = A2D_Sequence(1);
+	for(sample = 0, value = 0; (sample + SAMPLES_PER_BURST <= 64 * 64) && (sample + SAMPLES_PER_BURST <= recordedLength); sample += SAMPLES_PER_BURST)
+	{
+		A2D_Process_Burst(1, &recorded[sample], SAMPLES_PER_BURST);
+		if(A2D_Sequence(1) != sequence)
+		{
+			sequence = A2D_Sequence(1);
+			matched &= (A2D_Value(1) == (int)scanned[value++]);
+		}
+	}
+	Check(matched && (value == 64), "A2D_Process_Burst() of the recorded samples publishes the same 64 values as scanning them");
+
+	return;
+}
+
+void Check_Burst_Ring(void)
+{
+	unsigned int sequence;
+	unsigned long bursts;
+	int waiting;
+
+	//Continuous scanning with the main loop stalled, the ISR has to fill the ring and then drop (and count) the rest
+	Restart();
+	A2D_Sim_Waveform(0, A2D_SIM_DC, 700, 0, 1, 0);
+	Setup_Channel(0, RESOLUTION_10_BIT, 16, 1);
+	A2D_Scan_Mode(SCAN_MODE_CONTINUOUS);
+	A2D_Routine();
+	sequence = A2D_Sequence(0);
+	A2D_Sim_Run(200 * SAMPLES_PER_BURST * A2D_Sim_Cycles_Per_Sample());
+	bursts = A2D_Sim_Interrupts_Serviced() / 2;
+	waiting = A2D_Burst_High_Water_Mark();
+	Check((A2D_Dropped_Bursts() == bursts - waiting) && (waiting > 0), "A stalled main loop fills the burst ring and counts every burst dropped after that");
+
+	A2D_Routine();
+	Check((A2D_Sequence(0) - sequence == (unsigned int)waiting) && (A2D_Value(0) == 700), "A2D_Routine() then publishes every burst left waiting in the ring");
+
+	return;
+}
+
+void Check_Streaming(void)
+{
+	#ifdef A2D_STREAMING
+		unsigned long segments[8];
+		unsigned int plain = A2D_Sequence(0);
+		unsigned int streaming = A2D_Sequence(1);
+
+		//A 128 sample average in 8 segments publishes once per 16 sample block, 8 times as often, with the same value
+		Restart();
+		A2D_Sim_Waveform(0, A2D_SIM_DC, 321, 0, 1, 0);
+		A2D_Sim_Waveform(1, A2D_SIM_DC, 321, 0, 1, 0);
+		Setup_Channel(0, RESOLUTION_10_BIT, 128, 1);
+		Setup_Channel(1, RESOLUTION_10_BIT, 128, 1);
+		A2D_Channel_Streaming(1, segments, 8);
+		A2D_Scan_Mode(SCAN_MODE_CONTINUOUS);
+		Run_Until(0, 20, INSTRUCTION_RATE);
+		plain = A2D_Sequence(0) - plain;
+		streaming = A2D_Sequence(1) - streaming;
+		Check((A2D_Value(1) == 321) && (streaming >= 8 * plain - 8) && (streaming <= 8 * plain + 8), "A streaming channel publishes every block with the same value");
+	#else
+		printf("  skip Streaming, A2D_STREAMING isn't defined\n");
+	#endif
+
+	return;
+}
+
+void Check_Snapshot(void)
+{
+	unsigned int sequences[A2D_NUMBER_OF_CHANNELS];
+	int values[A2D_NUMBER_OF_CHANNELS];
+	A2D_CHANNEL_MASK changed;
+	int consistent;
+
+	Restart();
+	A2D_Sim_Waveform(0, A2D_SIM_DC, 200, 0, 1, 0);
+	A2D_Sim_Waveform(1, A2D_SIM_DC, 800, 0, 1, 0);
+	Setup_Channel(0, RESOLUTION_10_BIT, 16, 1);
+	Setup_Channel(1, RESOLUTION_10_BIT, 16, 1);
+	Run_Until(1, 2, INSTRUCTION_RATE);
+	memset(sequences, 0, sizeof(sequences));
+
+	//Everything has changed since sequence 0, and nothing has straight after reading it
+	consistent = A2D_Read_Channels(0x3, values, sequences, &changed);
+	Check(consistent && (changed == 0x3) && (values[0] == 200) && (values[1] == 800), "A2D_Read_Channels() reads every channel that has a new value");
+	consistent = A2D_Read_Channels(0x3, values, sequences, &changed);
+	Check(consistent && (changed == 0), "A2D_Read_Channels() skips channels that haven't changed since the last read");
+
+	return;
+}
+
+void Check_Filters(void)
+{
+	#ifdef A2D_FILTERS
+		unsigned int burst[SAMPLES_PER_BURST];
+		int unfiltered;
+		int parameter;
+		int sample;
+		int passed;
+
+		//A single spike in a burst of 500s has to vanish completely through each filter
+		Restart();
+		for(sample = 0; sample < SAMPLES_PER_BURST; sample++)
+			burst[sample] = 500;
+		burst[7] = 1023;
+
+		Setup_Channel(0, RESOLUTION_10_BIT, 16, 0);
+		A2D_Process_Burst(0, burst, SAMPLES_PER_BURST);
+		passed = A2D_Value(0) == 532;
+		A2D_Channel_Filter(0, FILTER_MEDIAN, 3);
+		A2D_Process_Burst(0, burst, SAMPLES_PER_BURST);
+		passed &= A2D_Value(0) == 500;
+		A2D_Channel_Filter(0, FILTER_MEDIAN, 5);
+		A2D_Process_Burst(0, burst, SAMPLES_PER_BURST);
+		passed &= A2D_Value(0) == 500;
+		A2D_Channel_Filter(0, FILTER_TRIMMED_MEAN, 1);
+		A2D_Process_Burst(0, burst, SAMPLES_PER_BURST);
+		passed &= A2D_Value(0) == 500;
+		A2D_Channel_Filter(0, FILTER_SIGMA, 12);
+		A2D_Process_Burst(0, burst, SAMPLES_PER_BURST);
+		passed &= A2D_Value(0) == 500;
+		Check(passed, "Median, trimmed mean and sigma filters remove a single spike that is otherwise averaged in");
+
+		//Every sample of a two level burst is exactly one sigma out, a tight enough limit rejects the lot and nothing is left to average
+		for(sample = 0; sample < SAMPLES_PER_BURST; sample++)
+			burst[sample] = (sample & 1) ? 1023 : 0;
+		A2D_Channel_Filter(0, FILTER_NONE, 0);
+		A2D_Process_Burst(0, burst, SAMPLES_PER_BURST);
+		unfiltered = A2D_Value(0);
+		passed = 1;
+		for(parameter = 1; parameter <= 63; parameter++)
+		{
+			A2D_Channel_Filter(0, FILTER_SIGMA, parameter);
+			A2D_Process_Burst(0, burst, SAMPLES_PER_BURST);
+			passed &= A2D_Value(0) == unfiltered;
+		}
+		Check(passed, "The sigma filter leaves a two level burst alone at every limit, even when it rejects every sample");
+	#else
+		printf("  skip Spike filters, A2D_FILTERS isn't defined\n");
+	#endif
+
+	return;
+}
+
+void Check_Events(void)
+{
+	#ifdef A2D_EVENTS
+		const int levels[] = {100, 600, 600, 480, 520, 100, 700};
+		unsigned int sequence;
+		int passed = 1;
+		int level;
+
+		//EVENT_ABOVE 500 with 50 of hysteresis: fires going to 600, not again until it has been below 450, so twice in all
+		Restart();
+		Setup_Channel(0, RESOLUTION_10_BIT, 16, 1);
+		A2D_Channel_Event(0, EVENT_ABOVE, 500, 0, 50);
+		finishedCalls = 0;
+		sequence = A2D_Sequence(0);
+		for(level = 0; level < (int)(sizeof(levels)/sizeof(levels[0])); level++)
+		{
+			A2D_Sim_Waveform(0, A2D_SIM_DC, levels[level], 0, 1, 0);
+			passed &= Run_Until(0, 2, INSTRUCTION_RATE) && (A2D_Value(0) == levels[level]);
+		}
+		Check(passed && (finishedCalls == 2) && (A2D_Sequence(0) - sequence >= 2 * sizeof(levels)/sizeof(levels[0])), "EVENT_ABOVE fires once per crossing, the hysteresis holds it off");
+	#else
+		printf("  skip Event rules, A2D_EVENTS isn't defined\n");
+	#endif
+
+	return;
+}
+
+void Check_Adaptive(void)
+{
+	#ifdef A2D_ADAPTIVE
+		unsigned int sequence;
+		unsigned long cycles;
+		int dropped;
+
+		//A step drops a 14 bit channel (256 samples a value) to 10 bits, so values come much quicker straight after it while steady
+		//blocks climb it back up, then it settles at 14 bits again
+		Restart();
+		A2D_Sim_Waveform(0, A2D_SIM_DC, 200, 0, 1, 0);
+		Setup_Channel(0, RESOLUTION_14_BIT, 1, 1);
+		A2D_Channel_Adaptive(0, RESOLUTION_10_BIT, 20);
+		Run_Until(0, 2, INSTRUCTION_RATE);
+
+		A2D_Sim_Waveform(0, A2D_SIM_DC, 800, 0, 1, 0);
+		sequence = A2D_Sequence(0);
+		Run_Until(0, 1, INSTRUCTION_RATE);
+		dropped = A2D_Channel_Resolution(0);
+		for(cycles = 0; cycles < 16 * SAMPLES_PER_BURST * A2D_Sim_Cycles_Per_Sample(); cycles += MAIN_LOOP_CYCLES)
+		{
+			A2D_Routine();
+			A2D_Sim_Run(MAIN_LOOP_CYCLES);
+		}
+		sequence = A2D_Sequence(0) - sequence;
+		Run_Until(0, 4, INSTRUCTION_RATE);
+		Check((sequence > 2) && (dropped < RESOLUTION_14_BIT) && (A2D_Channel_Resolution(0) == RESOLUTION_14_BIT) && (A2D_Value(0) == 800 * 16),
+			"Adaptive oversampling drops the resolution on a step and climbs back once steady");
+	#else
+		printf("  skip Adaptive oversampling, A2D_ADAPTIVE isn't defined\n");
+	#endif
+
+	return;
+}
+
+void Check_Timed(void)
+{
+	#ifdef A2D_TIMESTAMP
+		struct A2D_Burst_Jitter jitter;
+		unsigned long cycles;
+	#endif
+	unsigned long conversion;
+
+	Restart();
+	conversion = A2D_Sim_Cycles_Per_Sample();
+	Check(!A2D_Sample_Period((unsigned int)conversion - 1) && A2D_Sample_Period((unsigned int)conversion), "A2D_Sample_Period() rejects periods shorter than one conversion");
+
+	#ifdef A2D_TIMESTAMP
+		//However irregular the main loop is, Timer3 spaces every sample (and so every burst) the same
+		A2D_Sim_Waveform(0, A2D_SIM_SINE, 512, 300, 123457, 4);
+		Setup_Channel(0, RESOLUTION_10_BIT, 16, 1);
+		A2D_Scan_Mode(SCAN_MODE_TIMED);
+		A2D_Sample_Period(1600);
+		srand(1);
+		for(cycles = 0; cycles < INSTRUCTION_RATE; cycles += 1000)
+		{
+			A2D_Routine();
+			A2D_Sim_Run(500 + rand() % 1000);
+		}
+		A2D_Burst_Jitter(&jitter);
+		Check((jitter.intervals > 100) && (jitter.jitter == 0) && (jitter.averageInterval == 1600ul * SAMPLES_PER_BURST), "Timed scanning has no burst to burst jitter");
+	#else
+		printf("  skip Timed scanning jitter, A2D_TIMESTAMP() isn't defined\n");
+	#endif
+
+	return;
+}
+
+void Check_Calibration(void)
+{
+	#ifdef A2D_CALIBRATION
+		const int table[5] = {-400, 0, 300, 700, 1500};
+		const unsigned char columns[2] = {0, 1};
+		unsigned int raw[2 * 64];
+		int calibrated[2 * 64];
+		double reference;
+		double position;
+		int segment;
+		int sample;
+		int worst = 0;
+		int error;
+
+		//Offset, gain and a 4 segment table against the same sums done in floating point, within a count of rounding
+		Restart();
+		Setup_Channel(0, RESOLUTION_12_BIT, 4, 0);
+		Setup_Channel(1, RESOLUTION_12_BIT, 4, 0);
+		A2D_Channel_Calibration(0, -37, A2D_UNITY_GAIN + 300, table, 4);
+		A2D_Channel_Calibration(1, 12, A2D_UNITY_GAIN - 200, (void*)0, 0);
+		for(sample = 0; sample < 2 * 64; sample++)
+			raw[sample] = (unsigned int)(sample * 4093 / 127);
+		A2D_Calibrate_Channels(columns, 2, raw, calibrated, 64);
+
+		for(sample = 0; sample < 2 * 64; sample++)
+		{
+			reference = ((double)raw[sample] + ((sample & 1) ? 12 : -37)) * ((sample & 1) ? A2D_UNITY_GAIN - 200 : A2D_UNITY_GAIN + 300) / A2D_UNITY_GAIN;
+			reference = (reference < 0) ? 0 : (reference > 4095) ? 4095 : reference;
+			if(!(sample & 1))
+			{
+				position = reference / 1024;
+				segment = (int)position;
+				if(segment > 3)
+					segment = 3;
+				reference = table[segment] + (table[segment + 1] - table[segment]) * (position - segment);
+			}
+			error = abs(calibrated[sample] - (int)(reference + ((reference < 0) ? -0.5 : 0.5)));
+			if(error > worst)
+				worst = error;
+		}
+		printf("  %-4s Calibration of interleaved records against a floating point reference (worst error %d)\n", (worst <= 2) ? "ok" : "FAIL", worst);
+		checksRun++;
+		checksFailed += worst > 2;
+	#else
+		printf("  skip Batch calibration, A2D_CALIBRATION isn't defined\n");
+	#endif
+
+	return;
+}
+
+void Check_Gating(void)
+{
+	#ifdef A2D_GATING
+		unsigned long interrupts;
+		unsigned int sequence;
+
+		//A gated channel nobody has asked for leaves the module powered down, a request brings one value and then it is off again
+		Restart();
+		A2D_Sim_Waveform(0, A2D_SIM_DC, 345, 0, 1, 0);
+		Setup_Channel(0, RESOLUTION_10_BIT, 16, 1);
+		A2D_Channel_Gating(0, 1);
+		Run_Until(0, 1, 10 * MAIN_LOOP_CYCLES);
+		interrupts = A2D_Sim_Interrupts_Serviced();
+		Run_Until(0, 1, 100 * MAIN_LOOP_CYCLES);
+		Check(A2D_Idle() && (A2D_Sim_Interrupts_Serviced() == interrupts), "A gated channel that hasn't been requested is never scanned (module idle)");
+
+		sequence = A2D_Sequence(0);
+		A2D_Request(0);
+		Check(Run_Until(0, 1, INSTRUCTION_RATE) && (A2D_Value(0) == 345), "A2D_Request() brings a fresh value");
+		Run_Until(0, 1, 100 * MAIN_LOOP_CYCLES);
+		Check(A2D_Idle() && (A2D_Sequence(0) == sequence + 1), "The module powers back down once the request has been met");
+	#else
+		printf("  skip Gating, A2D_GATING isn't defined\n");
+	#endif
+
+	return;
+}
+
+void Check_Capture(void)
+{
+	#ifdef A2D_CAPTURE
+		unsigned int burst[SAMPLES_PER_BURST];
+		unsigned int ring[40];
+		const unsigned int *first;
+		const unsigned int *second;
+		int firstLength;
+		int secondLength;
+		int frozen;
+		int sample;
+
+		//A raw capture triggered by a sample above 900, frozen 16 samples later with 24 from before it
+		Restart();
+		Setup_Channel(0, RESOLUTION_10_BIT, 16, 0);
+		A2D_Channel_Capture(0, ring, 40, CAPTURE_RAW_SAMPLES, 16, 0, 900);
+		for(sample = 0; sample < 6 * SAMPLES_PER_BURST; sample++)
+		{
+			burst[sample % SAMPLES_PER_BURST] = (sample == 50) ? 1000 : sample;
+			if((sample % SAMPLES_PER_BURST) == SAMPLES_PER_BURST - 1)
+				A2D_Process_Burst(0, burst, SAMPLES_PER_BURST);
+		}
+		frozen = A2D_Capture_Read(0, &first, &firstLength, &second, &secondLength);
+		Check(frozen && (firstLength + secondLength == 40) && (first[0] == 27) && (((firstLength > 23) ? first[23] : second[23 - firstLength]) == 1000),
+			"A raw capture freezes after the trigger with the samples either side of it in order");
+	#else
+		printf("  skip Capture, A2D_CAPTURE isn't defined\n");
+	#endif
+
+	return;
+}
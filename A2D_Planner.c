@@ -0,0 +1,149 @@
+/**************************************************************************************************
+Target Hardware:		Linux host (gcc/clang)
+Chip resources used:	None, runs A2D.c against the simulated AD1 (and AD2) module (A2D_Sim.c)
+Purpose:				Print the scan schedule, predicted update periods and deadline slack of a config file before it is flashed
+
+Build with the project's host config.h (the one that includes A2D_Sim.h and lists A2D_STATIC_CHANNELS):
+	gcc -I<config dir> A2D_Planner.c A2D.c A2D_Sim.c <format/pre/post/finished functions> -lm -o A2D_Planner
+The functions named in the channel table have to be linked as well, either the application's own or empty stand-ins.
+Usage:
+	A2D_Planner [ticks per burst] [channels per burst] [continuous | timed]
+Without a burst time, A2D_BURST_TIME from the config file is used if it is set, otherwise the time the simulated module takes to
+convert 16 samples (in instruction cycles), or 16 Timer3 periods when timed. The settings apply to every module, except that
+only AD1 can be timed so any other module is planned as continuous. The exit code is 1 if any channel is predicted to miss its deadline.
+The deadline slack is only worked out when A2D_DEADLINES is defined in the config file, otherwise it is left blank.
+
+Version History:
+v1.2.0	2026-10-18  agent
+	Only checks the deadlines when A2D_DEADLINES is defined (A2D v2.0.0)
+v1.1.0	2026-10-18  agent
+	Prints the schedule of every module and channels beyond AN15 (A2D v1.16.0)
+v1.0.0	2026-10-18  agent
+	First version
+ **************************************************************************************************/
+/*************    Header Files    ***************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Config.h"
+#include "A2D.h"
+
+#ifndef A2D_STATIC_CHANNELS
+	#error "The planner reads the channel table, define A2D_STATIC_CHANNELS in config.h"
+#endif
+
+/*************   Magic  Numbers   ***************/
+#define SAMPLES_PER_BURST	16
+
+/*************Function  Prototypes***************/
+void Print_Schedule(int module);
+int Print_Channels(void);
+
+int main(int argc, char *argv[])
+{
+	unsigned long burstTime;
+	int channelsPerBurst = 1;
+	int module;
+	enum SCAN_MODE mode = SCAN_MODE_ON_DEMAND;
+
+	A2D_Sim_Reset();
+	A2D_Initialize();
+
+	//Arguments are all optional, but they are in order
+	if((argc > 3) && (strcmp(argv[3], "continuous") == 0))
+		mode = SCAN_MODE_CONTINUOUS;
+	if((argc > 3) && (strcmp(argv[3], "timed") == 0))
+		mode = SCAN_MODE_TIMED;
+	if(argc > 2)
+		channelsPerBurst = atoi(argv[2]);
+	for(module = 0; module < A2D_NUMBER_OF_MODULES; module++)
+	{
+		if(!A2D_Module_Scan_Mode(module, ((mode == SCAN_MODE_TIMED) && (module != 0)) ? SCAN_MODE_CONTINUOUS : mode) ||
+			!A2D_Module_Channels_Per_Burst(module, channelsPerBurst))
+		{
+			fprintf(stderr, "Invalid scan mode or channels per burst (1 to 16)\n");
+			return 2;
+		}
+	}
+
+	burstTime = (argc > 1) ? strtoul(argv[1], (void*)0, 0) : 0;
+	if(burstTime == 0)
+	{
+		#ifdef A2D_BURST_TIME
+			burstTime = A2D_BURST_TIME;
+		#else
+			if(mode == SCAN_MODE_TIMED)
+				burstTime = SAMPLES_PER_BURST * ((unsigned long)PR3 + 1);
+			else
+				burstTime = SAMPLES_PER_BURST * A2D_Sim_Cycles_Per_Sample();
+		#endif
+	}
+	for(module = 0; module < A2D_NUMBER_OF_MODULES; module++)
+		A2D_Module_Planner_Burst_Time(module, burstTime);
+
+	printf("Scan mode: %s, up to %d channel(s) per burst, %lu ticks per burst\n\n", (mode == SCAN_MODE_TIMED) ? "timed" : (mode == SCAN_MODE_CONTINUOUS) ? "continuous" : "on demand", channelsPerBurst, burstTime);
+	for(module = 0; module < A2D_NUMBER_OF_MODULES; module++)
+		Print_Schedule(module);
+
+	return Print_Channels() ? 0 : 1;
+}
+
+void Print_Schedule(int module)
+{
+	int slot;
+	int input;
+	unsigned long mask;
+
+	printf("AD%d schedule (%d bursts per cycle)\n", module + 1, A2D_Module_Schedule_Length(module));
+	printf("  Slot  CSSH:CSSL  Channels\n");
+	for(slot = 0; slot < A2D_Module_Schedule_Length(module); slot++)
+	{
+		mask = A2D_Module_Schedule_Mask(module, slot);
+		printf("  %4d  0x%04lX:%04lX", slot, mask >> 16, mask & 0xFFFF);
+		for(input = 0; input < A2D_INPUTS_PER_MODULE; input++)
+			if(mask & (1ul << input))
+				printf(" AN%d", input);
+		printf("\n");
+	}
+	printf("\n");
+
+	return;
+}
+
+int Print_Channels(void)
+{
+	int channel;
+	unsigned long predicted;
+	#ifdef A2D_DEADLINES
+		long slack;
+		A2D_CHANNEL_MASK missed = A2D_Missed_Deadlines();
+	#else
+		A2D_CHANNEL_MASK missed = 0;
+	#endif
+
+	printf("  Channel  Input     Bits  Predicted period  Deadline slack\n");
+	for(channel = 0; channel < A2D_NUMBER_OF_CHANNELS; channel++)
+	{
+		//Only the channels in the table
+		if(A2D_Channel_Resolution(channel) < 0)
+			continue;
+
+		predicted = A2D_Predicted_Period(channel);
+		printf("  %7d  AD%d/AN%-2d  %4d  ", channel, channel / A2D_INPUTS_PER_MODULE + 1, channel % A2D_INPUTS_PER_MODULE, 10 + A2D_Channel_Resolution(channel));
+		if(predicted == ~0ul)
+			printf("%16s  ", "never");
+		else
+			printf("%16lu  ", predicted);
+		#ifdef A2D_DEADLINES
+			slack = A2D_Channel_Slack(channel);
+			if(slack != 0x7FFFFFFFl)
+			{
+				printf("%14ld%s\n", slack, (missed & ((A2D_CHANNEL_MASK)1 << channel)) ? "  MISSED" : "");
+				continue;
+			}
+		#endif
+		printf("%14s\n", "-");
+	}
+
+	return missed == 0;
+}
@@ -0,0 +1,330 @@
+/**************************************************************************************************
+Target Hardware:		Linux host (gcc/clang)
+Chip resources used:	None, runs A2D.c against the simulated AD1 module (A2D_Sim.c) but feeds it recorded samples
+Purpose:				Replay raw A2D captures through the accumulation, decimation and formatting of the library
+
+Build with the project's host config.h (the one that includes A2D_Sim.h):
+	gcc -O2 -I<config dir> A2D_Replay.c A2D.c A2D_Sim.c <format/pre/post/finished functions> -lm -o A2D_Replay
+Usage:
+	A2D_Replay [-f bin | csv] [-c channel[,bits,averages[,round]]]... capture [output]
+Every record of the capture holds one raw sample per column, the columns are the channels given with -c in the order given.
+	bin - Unsigned 16-bit little endian samples, records back to back
+	csv - One record per line, values separated by commas (or spaces), lines that don't start with a number are skipped (headers)
+The format is taken from the file extension (.csv) unless -f is given. The samples of each channel are handed to the library
+16 at a time (A2D_Process_Burst()), the same as a burst that scanned only that channel, and every value the library publishes is
+written to the output (stdout by default) as "record,channel,value". The record is the one holding the last sample that went
+into the value. The samples processed per second are reported on stderr.
+
+Without A2D_STATIC_CHANNELS each -c also sets the channel up: the resolution in bits (10 to 16, default 10), the number of
+averages (default 16) and 1 to round rather than truncate. With A2D_STATIC_CHANNELS the table in config.h already says how
+each channel is processed (format functions included), -c only picks the columns (channel number only) and without any -c
+the columns are every channel of the table in ascending order.
+
+Version History:
+v1.0.0	2026-10-18  agent
+	First version
+ **************************************************************************************************/
+/*************    Header Files    ***************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Config.h"
+#include "A2D.h"
+
+/*************   Magic  Numbers   ***************/
+#define SAMPLES_PER_BURST	16
+#define MAX_SAMPLE			1023		//The converter is 10-bit, anything bigger is clamped
+#define OUTPUT_BUFFER_SIZE	(1 << 20)
+
+/*************  Global Variables  ***************/
+struct Replay_Column
+{
+	int channel;
+	unsigned int burst[SAMPLES_PER_BURST];	//Samples waiting to be handed over as a burst
+	int filled;
+	unsigned int sequence;					//A2D_Sequence() when the last value was written out
+} columns[A2D_NUMBER_OF_CHANNELS];
+int numberOfColumns;
+FILE *output;
+unsigned long long samplesClamped;
+unsigned long long valuesWritten;
+unsigned long long linesSkipped;
+
+/*************Function  Prototypes***************/
+int Add_Column(const char *settings);
+void Feed_Sample(struct Replay_Column *column, unsigned int sample, unsigned long long record);
+void Flush_Column(struct Replay_Column *column, unsigned long long record);
+unsigned long long Replay_Binary(const unsigned char *data, size_t size);
+unsigned long long Replay_CSV(const char *data, size_t size);
+
+int main(int argc, char *argv[])
+{
+	const char *format = (void*)0;
+	const char *capturePath;
+	const char *extension;
+	struct timespec start;
+	struct timespec finish;
+	struct stat status;
+	unsigned long long records;
+	unsigned long long samples;
+	double seconds;
+	void *capture;
+	int descriptor;
+	int argument;
+	int column;
+
+	A2D_Sim_Reset();
+	A2D_Initialize();
+
+	//Options first, then the capture and the output
+	for(argument = 1; (argument < argc) && (argv[argument][0] == '-') && (argv[argument][1] != '\0'); argument++)
+	{
+		if((strcmp(argv[argument], "-f") == 0) && (argument + 1 < argc))
+			format = argv[++argument];
+		else if((strcmp(argv[argument], "-c") == 0) && (argument + 1 < argc))
+		{
+			if(!Add_Column(argv[++argument]))
+			{
+				fprintf(stderr, "Invalid channel settings \"%s\"\n", argv[argument]);
+				return 2;
+			}
+		}
+		else
+			break;
+	}
+	if((argument >= argc) || (argv[argument][0] == '-'))
+	{
+		fprintf(stderr, "Usage: %s [-f bin | csv] [-c channel[,bits,averages[,round]]]... capture [output]\n", argv[0]);
+		return 2;
+	}
+	capturePath = argv[argument++];
+
+	#ifdef A2D_STATIC_CHANNELS
+		//Every channel of the table, in ascending order
+		if(numberOfColumns == 0)
+			for(column = 0; column < A2D_NUMBER_OF_CHANNELS; column++)
+				if(A2D_Channel_Resolution(column) >= 0)
+					columns[numberOfColumns++].channel = column;
+	#endif
+	if(numberOfColumns == 0)
+	{
+		fprintf(stderr, "No channels to replay, give at least one -c\n");
+		return 2;
+	}
+
+	if(format == (void*)0)
+	{
+		extension = strrchr(capturePath, '.');
+		format = ((extension != (void*)0) && (strcmp(extension, ".csv") == 0)) ? "csv" : "bin";
+	}
+	if((strcmp(format, "csv") != 0) && (strcmp(format, "bin") != 0))
+	{
+		fprintf(stderr, "Unknown format \"%s\"\n", format);
+		return 2;
+	}
+
+	//The whole capture is mapped rather than read, the kernel pages it in ahead of us
+	descriptor = open(capturePath, O_RDONLY);
+	if((descriptor < 0) || (fstat(descriptor, &status) != 0))
+	{
+		perror(capturePath);
+		return 2;
+	}
+	capture = (void*)0;
+	if(status.st_size > 0)
+	{
+		capture = mmap((void*)0, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if(capture == MAP_FAILED)
+		{
+			perror(capturePath);
+			return 2;
+		}
+		madvise(capture, (size_t)status.st_size, MADV_SEQUENTIAL);
+	}
+
+	output = stdout;
+	if((argument < argc) && (strcmp(argv[argument], "-") != 0))
+	{
+		output = fopen(argv[argument], "w");
+		if(output == (void*)0)
+		{
+			perror(argv[argument]);
+			return 2;
+		}
+	}
+	setvbuf(output, (void*)0, _IOFBF, OUTPUT_BUFFER_SIZE);
+	fprintf(output, "record,channel,value\n");
+
+	for(column = 0; column < numberOfColumns; column++)
+		columns[column].sequence = A2D_Sequence(columns[column].channel);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if(status.st_size == 0)
+		records = 0;
+	else if(strcmp(format, "csv") == 0)
+		records = Replay_CSV(capture, (size_t)status.st_size);
+	else
+		records = Replay_Binary(capture, (size_t)status.st_size);
+
+	//Whatever is left over is handed over as a short burst
+	for(column = 0; (records != 0) && (column < numberOfColumns); column++)
+		Flush_Column(&columns[column], records - 1);
+	clock_gettime(CLOCK_MONOTONIC, &finish);
+
+	if(output != stdout)
+		fclose(output);
+	else
+		fflush(output);
+	if(capture != (void*)0)
+		munmap(capture, (size_t)status.st_size);
+	close(descriptor);
+
+	samples = records * numberOfColumns;
+	seconds = (double)(finish.tv_sec - start.tv_sec) + (double)(finish.tv_nsec - start.tv_nsec) / 1e9;
+	fprintf(stderr, "%llu records, %llu samples, %llu values in %.3f s: %.0f samples/s (%.1f MB/s)\n", records, samples, valuesWritten,
+		seconds, (seconds > 0) ? (double)samples / seconds : 0.0, (seconds > 0) ? (double)status.st_size / seconds / 1e6 : 0.0);
+	if(samplesClamped)
+		fprintf(stderr, "%llu samples were above %d and were clamped\n", samplesClamped, MAX_SAMPLE);
+	if(linesSkipped)
+		fprintf(stderr, "%llu lines were skipped (headers or short records)\n", linesSkipped);
+
+	return 0;
+}
+
+int Add_Column(const char *settings)
+{
+	int channel;
+	int bits = 10;
+	int averages = 16;
+	int round = 0;
+	int column;
+	int fields;
+
+	fields = sscanf(settings, "%d,%d,%d,%d", &channel, &bits, &averages, &round);
+	if((fields < 1) || (numberOfColumns >= A2D_NUMBER_OF_CHANNELS))
+		return 0;
+
+	//A channel can only be one column, its samples would be mixed otherwise
+	for(column = 0; column < numberOfColumns; column++)
+		if(columns[column].channel == channel)
+			return 0;
+
+	#ifdef A2D_STATIC_CHANNELS
+		//The table decides how the channel is processed
+		if((fields > 1) || (A2D_Channel_Resolution(channel) < 0))
+			return 0;
+	#else
+		if(!A2D_Channel_Settings(channel, bits - 10, averages, NO_FORMATING, NO_PREFUNCTION, NO_POSTFUNCTION, NO_FINISHED_FUNCTION))
+			return 0;
+		A2D_Channel_Rounding(channel, round);
+	#endif
+
+	columns[numberOfColumns++].channel = channel;
+
+	return 1;
+}
+
+void Feed_Sample(struct Replay_Column *column, unsigned int sample, unsigned long long record)
+{
+	if(sample > MAX_SAMPLE)
+	{
+		sample = MAX_SAMPLE;
+		samplesClamped++;
+	}
+
+	column->burst[column->filled++] = sample;
+	if(column->filled == SAMPLES_PER_BURST)
+		Flush_Column(column, record);
+
+	return;
+}
+
+void Flush_Column(struct Replay_Column *column, unsigned long long record)
+{
+	unsigned int sequence;
+
+	if(column->filled == 0)
+		return;
+
+	A2D_Process_Burst(column->channel, column->burst, column->filled);
+	column->filled = 0;
+
+	//A burst publishes at most one value per channel
+	sequence = A2D_Sequence(column->channel);
+	if(sequence != column->sequence)
+	{
+		column->sequence = sequence;
+		fprintf(output, "%llu,%d,%d\n", record, column->channel, A2D_Value(column->channel));
+		valuesWritten++;
+	}
+
+	return;
+}
+
+unsigned long long Replay_Binary(const unsigned char *data, size_t size)
+{
+	size_t recordSize = 2 * (size_t)numberOfColumns;
+	unsigned long long records = size / recordSize;
+	unsigned long long record;
+	int column;
+
+	if(size % recordSize)
+		fprintf(stderr, "Ignoring %lu bytes of an incomplete record at the end of the capture\n", (unsigned long)(size % recordSize));
+
+	for(record = 0; record < records; record++)
+		for(column = 0; column < numberOfColumns; column++, data += 2)
+			Feed_Sample(&columns[column], data[0] | ((unsigned int)data[1] << 8), record);
+
+	return records;
+}
+
+unsigned long long Replay_CSV(const char *data, size_t size)
+{
+	const char *position = data;
+	const char *end = data + size;
+	const char *lineEnd;
+	unsigned int values[A2D_NUMBER_OF_CHANNELS];
+	unsigned long long records = 0;
+	int column;
+
+	while(position < end)
+	{
+		lineEnd = memchr(position, '\n', (size_t)(end - position));
+		if(lineEnd == (void*)0)
+			lineEnd = end;
+
+		//One number per column, hand parsed since the mapping isn't NUL terminated (and strtoul() is slow)
+		for(column = 0; column < numberOfColumns; column++)
+		{
+			while((position < lineEnd) && ((*position == ',') || (*position == ' ') || (*position == '\t')))
+				position++;
+			if((position >= lineEnd) || (*position < '0') || (*position > '9'))
+				break;
+			values[column] = 0;
+			while((position < lineEnd) && (*position >= '0') && (*position <= '9'))
+			{
+				if(values[column] <= MAX_SAMPLE)
+					values[column] = values[column] * 10 + (unsigned int)(*position - '0');
+				position++;
+			}
+		}
+
+		if(column == numberOfColumns)
+		{
+			for(column = 0; column < numberOfColumns; column++)
+				Feed_Sample(&columns[column], values[column], records);
+			records++;
+		}
+		else if((column != 0) || ((position < lineEnd) && (*position != '\r')))
+			linesSkipped++;//Blank lines aren't worth mentioning
+
+		position = lineEnd + 1;
+	}
+
+	return records;
+}
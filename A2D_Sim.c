@@ -0,0 +1,478 @@
+/**************************************************************************************************
+Target Hardware:		Linux host (gcc/clang)
+Chip resources used:	None, simulates the PIC24F AD1 module
+Purpose:				Stand in for the A2D peripheral so that A2D.c can be run, measured and regression tested off target
+
+Version History:
+v1.0.0	2026-10-18  agent
+	Simulates auto-convert (SSRC = 111) sampling with CSCNA scanning, SMPI interrupt spacing and BUFM/BUFS split buffers
+	Programmable DC/sine/square/ramp waveforms with optional noise, or user supplied signal sources
+v1.1.0	2026-10-18  agent
+	Added Timer3 and Timer3 triggered conversions (SSRC = 010)
+v1.2.0	2026-10-18  agent
+	Added a second module (AD2) running alongside AD1, and 32 analog inputs scanned through CSSL and CSSH
+ **************************************************************************************************/
+/*************    Header Files    ***************/
+#include <math.h>
+#include "A2D_Sim.h"
+
+/*************   Magic  Numbers   ***************/
+#define CONVERSION_TAD	12	//TAD required for the conversion itself once sampling has ended
+#define HALF_BUFFER		(A2D_SIM_BUFFER_SIZE/2)
+#define SAMPLE_CLOCK	0b111	//SSRC setting for internal counter auto-convert
+#define TIMER3_CLOCK	0b010	//SSRC setting for Timer3 compare ends sampling and starts conversion
+
+/*************  Global Variables  ***************/
+volatile struct A2D_Sim_Registers A2D_Sim_Module[A2D_SIM_NUMBER_OF_MODULES];
+volatile union A2D_Sim_IFS0 A2D_Sim_Ifs0;
+volatile union A2D_Sim_IEC0 A2D_Sim_Iec0;
+volatile union A2D_Sim_IFS1 A2D_Sim_Ifs1;
+volatile union A2D_Sim_IEC1 A2D_Sim_Iec1;
+volatile union A2D_Sim_T3CON A2D_Sim_T3con;
+volatile unsigned int A2D_Sim_Tmr3;
+volatile unsigned int A2D_Sim_Pr3;
+unsigned long long A2D_Sim_Cycle;
+
+struct A2D_Sim_Input
+{
+	enum A2D_SIM_WAVEFORM shape;
+	int offset;
+	int amplitude;
+	unsigned long period;
+	int noise;
+	int (*source)(int input, unsigned long long cycle);
+} simInputs[A2D_SIM_NUMBER_OF_INPUTS];
+
+struct
+{
+	int sampling;						//1 = A sample is currently being taken/converted
+	unsigned long cyclesUntilSample;	//Cycles remaining until the current conversion is written to the buffer
+	int fillPointer;					//Position within the (half) buffer that receives the next result
+	int scanIndex;						//Next CSSL/CSSH bit to be considered when scanning inputs
+	int samplesSinceInterrupt;			//Used to raise the interrupt every SMPI+1 samples
+	unsigned long lastScanMask;			//Used to detect scan list changes (which require the module to be cycled)
+} simSequence[A2D_SIM_NUMBER_OF_MODULES];
+
+struct
+{
+	unsigned long samplesConverted;
+	unsigned long interruptsServiced;
+	unsigned long noiseSeed;
+	int inInterrupt;					//Prevents an ISR that runs the simulator from nesting (both vectors share a priority)
+	unsigned long prescaleCount;		//Instruction cycles counted towards the next TMR3 increment
+} simModule;
+
+/*************Function  Prototypes***************/
+int Sim_Signal(int input);
+int Sim_Next_Scan_Input(int module);
+int Sim_Running(int module);
+unsigned long Sim_Scan_Mask(int module);
+unsigned long Sim_Cycles_Per_Sample(int module);
+void Sim_Reset_Sequence(int module);
+void Sim_Convert_Sample(int module);
+void Sim_Raise_Interrupt(int module);
+void Sim_Service_Interrupt(int module);
+unsigned long Sim_Cycles_To_Match(void);
+unsigned long Sim_Ticks_To_Match(void);
+int Sim_Advance_Timer(unsigned long cycles);
+
+void A2D_Sim_Reset(void)
+{
+	int input;
+	int module;
+
+	for(module = 0; module < A2D_SIM_NUMBER_OF_MODULES; ++module)
+	{
+		for(input = 0; input < A2D_SIM_BUFFER_SIZE; ++input)
+			A2D_Sim_Module[module].buffer[input] = 0;
+		A2D_Sim_Module[module].cssl = 0;
+		A2D_Sim_Module[module].cssh = 0;
+		A2D_Sim_Module[module].pcfgl = 0;
+		A2D_Sim_Module[module].pcfgh = 0;
+		A2D_Sim_Module[module].con1.word = 0;
+		A2D_Sim_Module[module].con2.word = 0;
+		A2D_Sim_Module[module].con3.word = 0;
+		A2D_Sim_Module[module].chs.word = 0;
+		Sim_Reset_Sequence(module);
+		simSequence[module].lastScanMask = 0;
+	}
+
+	for(input = 0; input < A2D_SIM_NUMBER_OF_INPUTS; ++input)
+	{
+		simInputs[input].shape = A2D_SIM_DC;
+		simInputs[input].offset = 0;
+		simInputs[input].amplitude = 0;
+		simInputs[input].period = 1;
+		simInputs[input].noise = 0;
+		simInputs[input].source = (void*)0;
+	}
+
+	A2D_Sim_Ifs0.word = 0;
+	A2D_Sim_Iec0.word = 0;
+	A2D_Sim_Ifs1.word = 0;
+	A2D_Sim_Iec1.word = 0;
+	A2D_Sim_T3con.word = 0;
+	A2D_Sim_Tmr3 = 0;
+	A2D_Sim_Pr3 = 0xFFFF;
+	A2D_Sim_Cycle = 0;
+
+	simModule.samplesConverted = 0;
+	simModule.interruptsServiced = 0;
+	simModule.noiseSeed = 1;
+	simModule.inInterrupt = 0;
+	simModule.prescaleCount = 0;
+
+	return;
+}
+
+int A2D_Sim_Waveform(int input, enum A2D_SIM_WAVEFORM shape, int offset, int amplitude, unsigned long period, int noise)
+{
+	//Range checking
+	if((input < 0) || (input >= A2D_SIM_NUMBER_OF_INPUTS))
+		return 0;//Failure
+
+	simInputs[input].shape = shape;
+	simInputs[input].offset = offset;
+	simInputs[input].amplitude = amplitude;
+	simInputs[input].period = period ? period : 1;
+	simInputs[input].noise = noise;
+	simInputs[input].source = (void*)0;
+
+	return 1;//Success
+}
+
+int A2D_Sim_Source(int input, int (*source)(int input, unsigned long long cycle))
+{
+	//Range checking
+	if((input < 0) || (input >= A2D_SIM_NUMBER_OF_INPUTS))
+		return 0;//Failure
+
+	simInputs[input].source = source;
+
+	return 1;//Success
+}
+
+void A2D_Sim_Run(unsigned long cycles)
+{
+	unsigned long step;
+	int running[A2D_SIM_NUMBER_OF_MODULES];
+	int matched;
+	int module;
+
+	while(cycles)
+	{
+		//Work out how far every module can go before something happens, the modules share time (and Timer3)
+		step = cycles;
+		for(module = 0; module < A2D_SIM_NUMBER_OF_MODULES; ++module)
+		{
+			//A pending interrupt is serviced as soon as it is enabled
+			Sim_Service_Interrupt(module);
+
+			//Turning the module off, or changing the scan list (which requires it to be turned off), restarts the sequence
+			if(!A2D_Sim_Module[module].con1.bits.ADON || (Sim_Scan_Mask(module) != simSequence[module].lastScanMask))
+			{
+				Sim_Reset_Sequence(module);
+				simSequence[module].lastScanMask = Sim_Scan_Mask(module);
+			}
+
+			running[module] = Sim_Running(module);
+			if(!running[module])
+			{
+				simSequence[module].sampling = 0;
+				continue;
+			}
+
+			//Timer3 ends sampling (and converts) on every period match
+			if(A2D_Sim_Module[module].con1.bits.SSRC == TIMER3_CLOCK)
+			{
+				if(Sim_Cycles_To_Match() < step)
+					step = Sim_Cycles_To_Match();
+				continue;
+			}
+
+			//Sampling has just been (re)started
+			if(!simSequence[module].sampling)
+			{
+				simSequence[module].sampling = 1;
+				simSequence[module].cyclesUntilSample = Sim_Cycles_Per_Sample(module);
+			}
+			if(simSequence[module].cyclesUntilSample < step)
+				step = simSequence[module].cyclesUntilSample;
+		}
+
+		//Advance to the next conversion of any module, or as far as we have been asked to go
+		matched = Sim_Advance_Timer(step);
+		A2D_Sim_Cycle += step;
+		cycles -= step;
+
+		for(module = 0; module < A2D_SIM_NUMBER_OF_MODULES; ++module)
+		{
+			//The ISR of the other module may have stopped this one at the same instant
+			if(!running[module] || !Sim_Running(module))
+				continue;
+
+			if(A2D_Sim_Module[module].con1.bits.SSRC == TIMER3_CLOCK)
+			{
+				if(matched)
+					Sim_Convert_Sample(module);
+				continue;
+			}
+
+			if(!simSequence[module].sampling)
+				continue;
+			simSequence[module].cyclesUntilSample -= step;
+			if(simSequence[module].cyclesUntilSample == 0)
+			{
+				Sim_Convert_Sample(module);
+				simSequence[module].cyclesUntilSample = Sim_Cycles_Per_Sample(module);
+			}
+		}
+	}
+
+	return;
+}
+
+unsigned long A2D_Sim_Cycles_Per_Sample(void)
+{
+	return Sim_Cycles_Per_Sample(0);
+}
+
+unsigned long A2D_Sim_Samples_Converted(void)
+{
+	return simModule.samplesConverted;
+}
+
+unsigned long A2D_Sim_Interrupts_Serviced(void)
+{
+	return simModule.interruptsServiced;
+}
+
+int Sim_Running(int module)
+{
+	volatile struct A2D_Sim_Registers *registers = &A2D_Sim_Module[module];
+
+	//Only automatic sampling with auto-convert or a running Timer3 trigger is simulated
+	if(!registers->con1.bits.ADON || !registers->con1.bits.ASAM)
+		return 0;
+	if(registers->con1.bits.SSRC == SAMPLE_CLOCK)
+		return 1;
+	return (registers->con1.bits.SSRC == TIMER3_CLOCK) && T3CONbits.TON;
+}
+
+unsigned long Sim_Scan_Mask(int module)
+{
+	return ((unsigned long)A2D_Sim_Module[module].cssh << 16) | A2D_Sim_Module[module].cssl;
+}
+
+unsigned long Sim_Cycles_Per_Sample(int module)
+{
+	volatile struct A2D_Sim_Registers *registers = &A2D_Sim_Module[module];
+	unsigned long tad;
+	unsigned long samplingTad;
+
+	//TAD is either the internal RC clock or (ADCS + 1) instruction cycles
+	if(registers->con3.bits.ADRC)
+		tad = A2D_SIM_RC_TAD_CYCLES;
+	else
+		tad = registers->con3.bits.ADCS + 1;
+
+	//Sampling is a minimum of 1 TAD
+	samplingTad = registers->con3.bits.SAMC ? registers->con3.bits.SAMC : 1;
+
+	return (samplingTad + CONVERSION_TAD) * tad;
+}
+
+unsigned long Sim_Cycles_To_Match(void)
+{
+	unsigned long prescale = 1ul << (3 * T3CONbits.TCKPS);	//1:1, 1:8, 1:64, 1:256
+
+	return Sim_Ticks_To_Match() * prescale - simModule.prescaleCount;
+}
+
+unsigned long Sim_Ticks_To_Match(void)
+{
+	//TMR3 resets on the tick after it reaches PR3, if it is already past PR3 it has to wrap around first
+	if(A2D_Sim_Tmr3 <= A2D_Sim_Pr3)
+		return (unsigned long)A2D_Sim_Pr3 - A2D_Sim_Tmr3 + 1;
+	return 0x10000ul - A2D_Sim_Tmr3 + A2D_Sim_Pr3 + 1;
+}
+
+int Sim_Advance_Timer(unsigned long cycles)
+{
+	unsigned long prescale = 1ul << (3 * T3CONbits.TCKPS);
+	unsigned long ticks;
+	unsigned long toMatch;
+
+	if(!T3CONbits.TON)
+		return 0;
+
+	//Whole ticks of the prescaled clock
+	simModule.prescaleCount += cycles;
+	ticks = simModule.prescaleCount / prescale;
+	simModule.prescaleCount %= prescale;
+
+	toMatch = Sim_Ticks_To_Match();
+	if(ticks < toMatch)
+	{
+		A2D_Sim_Tmr3 = (unsigned int)((A2D_Sim_Tmr3 + ticks) & 0xFFFF);
+		return 0;
+	}
+
+	//Only whether a match happened matters, A2D_Sim_Run() never steps past more than one when it is watching for them
+	A2D_Sim_Tmr3 = (unsigned int)((ticks - toMatch) % ((unsigned long)A2D_Sim_Pr3 + 1));
+	return 1;
+}
+
+void Sim_Reset_Sequence(int module)
+{
+	simSequence[module].sampling = 0;
+	simSequence[module].fillPointer = 0;
+	simSequence[module].scanIndex = 0;
+	simSequence[module].samplesSinceInterrupt = 0;
+	A2D_Sim_Module[module].con2.bits.BUFS = 0;
+
+	return;
+}
+
+void Sim_Convert_Sample(int module)
+{
+	volatile struct A2D_Sim_Registers *registers = &A2D_Sim_Module[module];
+	int input;
+	int position;
+
+	//Choose the input, either the next one in the scan list or MUX A
+	input = Sim_Next_Scan_Input(module);
+
+	//Write the result into the active (half) buffer
+	position = simSequence[module].fillPointer;
+	if(registers->con2.bits.BUFM && registers->con2.bits.BUFS)
+		position += HALF_BUFFER;
+	registers->buffer[position % A2D_SIM_BUFFER_SIZE] = (unsigned int)Sim_Signal(input);
+	++simSequence[module].fillPointer;
+	++simModule.samplesConverted;
+	registers->con1.bits.DONE = 1;
+
+	//Raise the interrupt every SMPI + 1 samples
+	if(++simSequence[module].samplesSinceInterrupt >= (registers->con2.bits.SMPI + 1))
+	{
+		simSequence[module].samplesSinceInterrupt = 0;
+		simSequence[module].fillPointer = 0;
+		simSequence[module].scanIndex = 0;//The scan sequence starts over on each interrupt
+		if(registers->con2.bits.BUFM)
+			registers->con2.bits.BUFS ^= 1;
+		Sim_Raise_Interrupt(module);
+		Sim_Service_Interrupt(module);
+	}
+	else if(simSequence[module].fillPointer >= (registers->con2.bits.BUFM ? HALF_BUFFER : A2D_SIM_BUFFER_SIZE))
+		simSequence[module].fillPointer = 0;
+
+	return;
+}
+
+int Sim_Next_Scan_Input(int module)
+{
+	unsigned long scanMask = Sim_Scan_Mask(module);
+	int checked;
+
+	if(!A2D_Sim_Module[module].con2.bits.CSCNA || (scanMask == 0))
+		return A2D_Sim_Module[module].chs.bits.CH0SA;
+
+	//Scan upwards from where we left off, wrapping to the lowest selected input
+	for(checked = 0; checked < A2D_SIM_NUMBER_OF_INPUTS; ++checked)
+	{
+		if(simSequence[module].scanIndex >= A2D_SIM_NUMBER_OF_INPUTS)
+			simSequence[module].scanIndex = 0;
+		if(scanMask & (1ul << simSequence[module].scanIndex))
+			return simSequence[module].scanIndex++;
+		++simSequence[module].scanIndex;
+	}
+
+	return A2D_Sim_Module[module].chs.bits.CH0SA;
+}
+
+int Sim_Signal(int input)
+{
+	struct A2D_Sim_Input *signal;
+	unsigned long long phase;
+	long value;
+
+	//Inputs without a pin (eg AVDD on CH0SA = 0111 for some parts) simply read full scale
+	if((input < 0) || (input >= A2D_SIM_NUMBER_OF_INPUTS))
+		return A2D_SIM_MAX_VALUE;
+
+	signal = &simInputs[input];
+	if(signal->source != (void*)0)
+		value = signal->source(input, A2D_Sim_Cycle);
+	else
+	{
+		phase = A2D_Sim_Cycle % signal->period;
+		switch(signal->shape)
+		{
+			case A2D_SIM_SINE:
+				value = signal->offset + lround(signal->amplitude * sin(6.283185307179586 * (double)phase / (double)signal->period));
+				break;
+			case A2D_SIM_SQUARE:
+				value = signal->offset + ((phase < signal->period/2) ? signal->amplitude : -signal->amplitude);
+				break;
+			case A2D_SIM_RAMP:
+				value = signal->offset + (long)(((long long)signal->amplitude * (long long)phase) / (long long)signal->period);
+				break;
+			case A2D_SIM_DC:
+			default:
+				value = signal->offset;
+				break;
+		}
+
+		//Uniform noise from a simple LCG, deterministic so that runs can be compared
+		if(signal->noise)
+		{
+			simModule.noiseSeed = simModule.noiseSeed * 1103515245ul + 12345ul;
+			value += (long)((simModule.noiseSeed >> 16) % (unsigned long)(2 * signal->noise + 1)) - signal->noise;
+		}
+	}
+
+	//Saturate like the converter would
+	if(value < 0)
+		value = 0;
+	else if(value > A2D_SIM_MAX_VALUE)
+		value = A2D_SIM_MAX_VALUE;
+
+	return (int)value;
+}
+
+void Sim_Raise_Interrupt(int module)
+{
+	if(module == 0)
+		IFS0bits.AD1IF = 1;
+	else
+		IFS1bits.AD2IF = 1;
+
+	return;
+}
+
+void Sim_Service_Interrupt(int module)
+{
+	if(simModule.inInterrupt)
+		return;
+
+	if(module == 0)
+	{
+		if(!IFS0bits.AD1IF || !IEC0bits.AD1IE)
+			return;
+		simModule.inInterrupt = 1;
+		++simModule.interruptsServiced;
+		_ADC1Interrupt();
+	}
+	else
+	{
+		//A library built for a single module has no AD2 vector, the flag just stays set
+		if(!IFS1bits.AD2IF || !IEC1bits.AD2IE || (_ADC2Interrupt == (void*)0))
+			return;
+		simModule.inInterrupt = 1;
+		++simModule.interruptsServiced;
+		_ADC2Interrupt();
+	}
+	simModule.inInterrupt = 0;
+
+	return;
+}
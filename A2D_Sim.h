@@ -0,0 +1,268 @@
+/*
+ Instructions for running the A2D library on a Linux host:
+This file stands in for the device header on a host build. Include it from the host copy of config.h (in place of the
+XC16 device header) and the A2D library will compile against the simulated SFRs declared below instead of the real AD1
+(and AD2) peripherals. Add A2D_Sim.c to the host build alongside A2D.c.
+
+Each analog input is driven by a programmable waveform set through A2D_Sim_Waveform(). Time only moves when A2D_Sim_Run()
+is called; during that call the simulated module converts samples (honouring ADON, ASAM, CSCNA, AD1CSSL, AD1CSSH, SMPI, BUFM
+and BUFS) and calls _ADC1Interrupt() whenever AD1IF is raised while AD1IE is set, the same as the hardware would.
+
+Two modules are simulated, AD1 and AD2, each with its own registers, buffer and sequence, running side by side in the same
+simulated time. AD2 raises AD2IF (IFS1<5>) and calls _ADC2Interrupt() if the build has one. The 32 analog inputs are shared,
+as on parts with two converters, so AN8 reads the same signal whichever module scans it.
+
+Both the internal counter (SSRC = 111) and Timer3 (SSRC = 010) conversion triggers are simulated. Timer3 (T3CON TON/TCKPS,
+TMR3 and PR3) counts instruction cycles whenever it is on. In Timer3 mode the sample is taken at the period match and the
+result is written straight away (the conversion time itself is not modelled), so samples are exactly one period apart.
+
+A2D_Sim_Cycle counts instruction cycles since A2D_Sim_Reset() and can be used as a timestamp by code that needs one, for
+example "#define A2D_TIMESTAMP() A2D_SIM_TIMESTAMP()" in the host config.h. Note that code runs in zero simulated time, so
+to measure how long the library itself takes use a real host clock as the timestamp instead.
+*/
+
+#ifndef A2D_SIM_H
+#define A2D_SIM_H
+
+/************* Semantic Versioning***************/
+#define A2D_SIM_LIBRARY
+
+/*************   Magic  Numbers   ***************/
+#define A2D_SIM_NUMBER_OF_INPUTS	32
+#define A2D_SIM_NUMBER_OF_MODULES	2
+#define A2D_SIM_BUFFER_SIZE			16
+#define A2D_SIM_RC_TAD_CYCLES		4		//A/D internal RC clock period expressed in instruction cycles (~250ns at 16 MIPS)
+#define A2D_SIM_MAX_VALUE			1023	//10-bit converter
+
+#define A2D_SIM_TIMESTAMP()		((unsigned long)A2D_Sim_Cycle)
+
+//The host compiler has no notion of a PIC24 interrupt vector, the ISR is called as a plain function
+#define A2D_INTERRUPT_ATTRIBUTES
+
+/*************    Enumeration     ***************/
+enum A2D_SIM_WAVEFORM
+{
+	A2D_SIM_DC,			//offset
+	A2D_SIM_SINE,		//offset + amplitude * sin(2*pi*t/period)
+	A2D_SIM_SQUARE,		//offset + amplitude for the first half of the period, offset - amplitude for the second
+	A2D_SIM_RAMP		//offset + amplitude * (t % period) / period
+};
+
+/*************  Register Layouts  ***************/
+typedef struct
+{
+	unsigned DONE:1;
+	unsigned SAMP:1;
+	unsigned ASAM:1;
+	unsigned :2;
+	unsigned SSRC:3;
+	unsigned FORM:2;
+	unsigned :3;
+	unsigned ADSIDL:1;
+	unsigned :1;
+	unsigned ADON:1;
+} A2D_SIM_AD1CON1BITS;
+
+typedef struct
+{
+	unsigned ALTS:1;
+	unsigned BUFM:1;
+	unsigned SMPI:4;
+	unsigned :1;
+	unsigned BUFS:1;
+	unsigned :2;
+	unsigned CSCNA:1;
+	unsigned :1;
+	unsigned OFFCAL:1;
+	unsigned VCFG:3;
+} A2D_SIM_AD1CON2BITS;
+
+typedef struct
+{
+	unsigned ADCS:8;
+	unsigned SAMC:5;
+	unsigned :2;
+	unsigned ADRC:1;
+} A2D_SIM_AD1CON3BITS;
+
+typedef struct
+{
+	unsigned CH0SA:5;
+	unsigned :2;
+	unsigned CH0NA:1;
+	unsigned CH0SB:5;
+	unsigned :2;
+	unsigned CH0NB:1;
+} A2D_SIM_AD1CHSBITS;
+
+typedef struct
+{
+	unsigned :1;
+	unsigned TCS:1;
+	unsigned :2;
+	unsigned TCKPS:2;
+	unsigned TGATE:1;
+	unsigned :6;
+	unsigned TSIDL:1;
+	unsigned :1;
+	unsigned TON:1;
+} A2D_SIM_T3CONBITS;
+
+typedef struct
+{
+	unsigned :13;
+	unsigned AD1IF:1;
+	unsigned :2;
+} A2D_SIM_IFS0BITS;
+
+typedef struct
+{
+	unsigned :13;
+	unsigned AD1IE:1;
+	unsigned :2;
+} A2D_SIM_IEC0BITS;
+
+typedef struct
+{
+	unsigned :5;
+	unsigned AD2IF:1;
+	unsigned :10;
+} A2D_SIM_IFS1BITS;
+
+typedef struct
+{
+	unsigned :5;
+	unsigned AD2IE:1;
+	unsigned :10;
+} A2D_SIM_IEC1BITS;
+
+union A2D_Sim_AD1CON1	{unsigned int word; A2D_SIM_AD1CON1BITS bits;};
+union A2D_Sim_AD1CON2	{unsigned int word; A2D_SIM_AD1CON2BITS bits;};
+union A2D_Sim_AD1CON3	{unsigned int word; A2D_SIM_AD1CON3BITS bits;};
+union A2D_Sim_AD1CHS	{unsigned int word; A2D_SIM_AD1CHSBITS bits;};
+union A2D_Sim_IFS0		{unsigned int word; A2D_SIM_IFS0BITS bits;};
+union A2D_Sim_IEC0		{unsigned int word; A2D_SIM_IEC0BITS bits;};
+union A2D_Sim_IFS1		{unsigned int word; A2D_SIM_IFS1BITS bits;};
+union A2D_Sim_IEC1		{unsigned int word; A2D_SIM_IEC1BITS bits;};
+union A2D_Sim_T3CON		{unsigned int word; A2D_SIM_T3CONBITS bits;};
+
+//The registers of one converter, AD2 has the same layout as AD1
+struct A2D_Sim_Registers
+{
+	unsigned int buffer[A2D_SIM_BUFFER_SIZE];
+	unsigned int cssl;
+	unsigned int cssh;
+	unsigned int pcfgl;
+	unsigned int pcfgh;
+	union A2D_Sim_AD1CON1 con1;
+	union A2D_Sim_AD1CON2 con2;
+	union A2D_Sim_AD1CON3 con3;
+	union A2D_Sim_AD1CHS chs;
+};
+
+/************* Simulated  Registers *************/
+extern volatile struct A2D_Sim_Registers A2D_Sim_Module[A2D_SIM_NUMBER_OF_MODULES];
+extern volatile union A2D_Sim_IFS0 A2D_Sim_Ifs0;
+extern volatile union A2D_Sim_IEC0 A2D_Sim_Iec0;
+extern volatile union A2D_Sim_IFS1 A2D_Sim_Ifs1;
+extern volatile union A2D_Sim_IEC1 A2D_Sim_Iec1;
+extern volatile union A2D_Sim_T3CON A2D_Sim_T3con;
+extern volatile unsigned int A2D_Sim_Tmr3;
+extern volatile unsigned int A2D_Sim_Pr3;
+extern unsigned long long A2D_Sim_Cycle;
+
+#define ADC1BUF0		A2D_Sim_Module[0].buffer[0]
+#define AD1CSSL			A2D_Sim_Module[0].cssl
+#define AD1CSSH			A2D_Sim_Module[0].cssh
+#define AD1PCFG			A2D_Sim_Module[0].pcfgl
+#define AD1PCFGL		A2D_Sim_Module[0].pcfgl
+#define AD1PCFGH		A2D_Sim_Module[0].pcfgh
+#define AD1CON1			A2D_Sim_Module[0].con1.word
+#define AD1CON1bits		A2D_Sim_Module[0].con1.bits
+#define AD1CON2			A2D_Sim_Module[0].con2.word
+#define AD1CON2bits		A2D_Sim_Module[0].con2.bits
+#define AD1CON3			A2D_Sim_Module[0].con3.word
+#define AD1CON3bits		A2D_Sim_Module[0].con3.bits
+#define AD1CHS			A2D_Sim_Module[0].chs.word
+#define AD1CHSbits		A2D_Sim_Module[0].chs.bits
+#define ADC2BUF0		A2D_Sim_Module[1].buffer[0]
+#define AD2CSSL			A2D_Sim_Module[1].cssl
+#define AD2CSSH			A2D_Sim_Module[1].cssh
+#define AD2PCFGL		A2D_Sim_Module[1].pcfgl
+#define AD2PCFGH		A2D_Sim_Module[1].pcfgh
+#define AD2CON1			A2D_Sim_Module[1].con1.word
+#define AD2CON1bits		A2D_Sim_Module[1].con1.bits
+#define AD2CON2			A2D_Sim_Module[1].con2.word
+#define AD2CON2bits		A2D_Sim_Module[1].con2.bits
+#define AD2CON3			A2D_Sim_Module[1].con3.word
+#define AD2CON3bits		A2D_Sim_Module[1].con3.bits
+#define AD2CHS			A2D_Sim_Module[1].chs.word
+#define AD2CHSbits		A2D_Sim_Module[1].chs.bits
+#define IFS0			A2D_Sim_Ifs0.word
+#define IFS0bits		A2D_Sim_Ifs0.bits
+#define IEC0			A2D_Sim_Iec0.word
+#define IEC0bits		A2D_Sim_Iec0.bits
+#define IFS1			A2D_Sim_Ifs1.word
+#define IFS1bits		A2D_Sim_Ifs1.bits
+#define IEC1			A2D_Sim_Iec1.word
+#define IEC1bits		A2D_Sim_Iec1.bits
+#define T3CON			A2D_Sim_T3con.word
+#define T3CONbits		A2D_Sim_T3con.bits
+#define TMR3			A2D_Sim_Tmr3
+#define PR3				A2D_Sim_Pr3
+
+/*************Function  Prototypes***************/
+/**
+ * Returns every simulated register to its power on state, clears all waveforms and resets the cycle counter
+ */
+void A2D_Sim_Reset(void);
+
+/**
+ * Programs the signal seen by a simulated analog input
+ * @param input The analog input (0 to 31) that the waveform drives
+ * @param shape The shape of the waveform, see enum A2D_SIM_WAVEFORM
+ * @param offset The DC offset of the waveform in A2D counts
+ * @param amplitude The amplitude of the waveform in A2D counts (ignored for A2D_SIM_DC)
+ * @param period The period of the waveform in instruction cycles (ignored for A2D_SIM_DC)
+ * @param noise Peak amplitude of uniformly distributed noise added to every sample in A2D counts (0 for a clean signal)
+ * @return 1 = Success, 0 = Failure - Input out of range
+ */
+int A2D_Sim_Waveform(int input, enum A2D_SIM_WAVEFORM shape, int offset, int amplitude, unsigned long period, int noise);
+
+/**
+ * Replaces the programmed waveform of an input with a user supplied signal source
+ * @param input The analog input (0 to 31) that the source drives
+ * @param source Function returning the raw A2D counts for the input at the given cycle, (void*)0 restores the waveform
+ * @return 1 = Success, 0 = Failure - Input out of range
+ */
+int A2D_Sim_Source(int input, int (*source)(int input, unsigned long long cycle));
+
+/**
+ * Advances simulated time, converting samples and raising _ADC1Interrupt() (and _ADC2Interrupt()) as the hardware would
+ * @param cycles The number of instruction cycles to advance
+ */
+void A2D_Sim_Run(unsigned long cycles);
+
+/**
+ * Returns the number of instruction cycles a single sample and conversion takes with the current AD1CON3 settings (AD2 is the same for the same settings)
+ * @return Instruction cycles per converted sample
+ */
+unsigned long A2D_Sim_Cycles_Per_Sample(void);
+
+/**
+ * Returns the number of samples converted since A2D_Sim_Reset()
+ * @return Total number of converted samples, by every module
+ */
+unsigned long A2D_Sim_Samples_Converted(void);
+
+/**
+ * Returns the number of times _ADC1Interrupt() (or _ADC2Interrupt()) has been called since A2D_Sim_Reset()
+ * @return Total number of interrupts serviced
+ */
+unsigned long A2D_Sim_Interrupts_Serviced(void);
+
+//Provided by A2D.c, AD2 is only serviced when the library is built for two modules
+void _ADC1Interrupt(void);
+void _ADC2Interrupt(void) __attribute__((weak));
+
+#endif